@@ -2,18 +2,29 @@ CFLAGS   += -pthread
 CXXFLAGS += -std=c++1z
 LDFLAGS  += -lstdc++fs -pthread
 
+# Uncomment to compile in the TRACE_* instrumentation (see
+# util/trace.hpp).
+#CXXFLAGS += -DENABLE_TRACING
+
+# Uncomment to count allocations by replacing the global operator
+# new/delete (see util/alloc-tracker.hpp).
+#CXXFLAGS += -DTRACK_ALLOCATIONS
+
 xml.deps       = pugixml util
 sqlite.deps    = sqlite-amal util smcpp
-crypto.deps    = md5
+crypto.deps    = md5 util
+harness.deps   = util
 
 # Must be in order of dependencies.
-top-level-folders = util xml sqlite crypto test
+top-level-folders = util xml sqlite crypto bench test
 
-main.deps = $(top-level-folders)
-test.deps = $(filter-out test,$(top-level-folders))
+main.deps  = $(filter-out bench,$(top-level-folders))
+test.deps  = $(filter-out test bench,$(top-level-folders)) harness
+bench.deps = $(filter-out test bench,$(top-level-folders)) harness
 
-main_is = main
-test_is = test
+main_is  = main
+test_is  = test
+bench_is = bench
 
 $(call enter_all,$(top-level-folders))
 
@@ -0,0 +1,135 @@
+/****************************************************************
+* Benchmarks for bi-directional maps
+****************************************************************/
+#include "common-bench.hpp"
+
+#include "bimap.hpp"
+
+#include <random>
+
+using namespace std;
+
+namespace bench {
+
+namespace {
+
+// Keys  are  spread  out (not dense) so that they don't form an
+// arithmetic sequence that would make any layout look good.
+vector<tuple<int, int>> make_pairs( size_t n ) {
+    vector<tuple<int, int>> res;
+    for( size_t i = 0; i < n; ++i )
+        res.emplace_back( int( i*37 + 11 ), -int( i ) );
+    return res;
+}
+
+// Random  keys  that  are  all in a map of the given size, so that
+// the lookups don't follow the memory layout.
+vector<int> make_queries( size_t n, size_t count ) {
+    mt19937 rng( 42 );
+    uniform_int_distribution<size_t> d( 0, n-1 );
+    vector<int> res;
+    for( size_t i = 0; i < count; ++i )
+        res.push_back( int( d( rng )*37 + 11 ) );
+    return res;
+}
+
+constexpr size_t num_queries = 1000;
+
+util::BDIndexMap<int> make_index( size_t n, util::SearchLayout l ) {
+    vector<int> v;
+    for( size_t i = 0; i < n; ++i )
+        v.push_back( int( i*37 + 11 ) );
+    return util::BDIndexMap<int>( move( v ), true, l );
+}
+
+} // anonymous namespace
+
+BENCH_ARGS( bimap_fixed_val, 10, 1000, 1000000 )
+{
+    util::BiMapFixed<int, int> bm( make_pairs( state.arg() ), true );
+    auto qs = make_queries( state.arg(), num_queries );
+    while( state.loop() )
+        for( int q : qs )
+            do_not_optimize( bm.val( q ) );
+    state.set_items_per_iter( qs.size() );
+}
+
+BENCH_ARGS( bimap_fixed_key, 10, 1000, 1000000 )
+{
+    util::BiMapFixed<int, int> bm( make_pairs( state.arg() ), true );
+    auto qs = make_queries( state.arg(), num_queries );
+    for( int& q : qs ) q = -(q-11)/37;
+    while( state.loop() )
+        for( int q : qs )
+            do_not_optimize( bm.key( q ) );
+    state.set_items_per_iter( qs.size() );
+}
+
+BENCH_ARGS( bimap_hashed_val, 10, 1000, 1000000 )
+{
+    util::BiMapHashed<int, int> bm( make_pairs( state.arg() ), true );
+    auto qs = make_queries( state.arg(), num_queries );
+    while( state.loop() )
+        for( int q : qs )
+            do_not_optimize( bm.val( q ) );
+    state.set_items_per_iter( qs.size() );
+}
+
+BENCH_ARGS( bimap_hashed_key, 10, 1000, 1000000 )
+{
+    util::BiMapHashed<int, int> bm( make_pairs( state.arg() ), true );
+    auto qs = make_queries( state.arg(), num_queries );
+    for( int& q : qs ) q = -(q-11)/37;
+    while( state.loop() )
+        for( int q : qs )
+            do_not_optimize( bm.key( q ) );
+    state.set_items_per_iter( qs.size() );
+}
+
+BENCH_ARGS( bdindexmap_sorted, 1000, 1000000 )
+{
+    auto bm = make_index( state.arg(), util::SearchLayout::sorted );
+    auto qs = make_queries( state.arg(), num_queries );
+    while( state.loop() )
+        for( int q : qs )
+            do_not_optimize( bm.key_safe( q ) );
+    state.set_items_per_iter( qs.size() );
+}
+
+BENCH_ARGS( bdindexmap_eytzinger, 1000, 1000000 )
+{
+    auto bm = make_index( state.arg(), util::SearchLayout::eytzinger );
+    auto qs = make_queries( state.arg(), num_queries );
+    while( state.loop() )
+        for( int q : qs )
+            do_not_optimize( bm.key_safe( q ) );
+    state.set_items_per_iter( qs.size() );
+}
+
+// Compare with bdindexmap_sorted/1000000.
+BENCH( bdindexmap_batch )
+{
+    auto bm = make_index( 1000000, util::SearchLayout::sorted );
+    auto qs = make_queries( 1000000, num_queries );
+    while( state.loop() )
+        do_not_optimize( bm.keys_of_safe( qs ) );
+    state.set_items_per_iter( qs.size() );
+}
+
+// Insert and erase in a steady state of 100k entries.
+BENCH( bimap_mutable_churn )
+{
+    util::BiMap<int, int> bm;
+    size_t const n = 100000;
+    for( size_t i = 0; i < n; ++i )
+        bm.insert( int( i ), -int( i ) );
+    int next = int( n );
+    while( state.loop() ) {
+        bm.erase_key( next-int( n ) );
+        bm.insert( next, -next );
+        ++next;
+    }
+    state.set_items_per_iter( 2 );
+}
+
+} // namespace bench
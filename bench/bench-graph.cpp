@@ -0,0 +1,199 @@
+/****************************************************************
+* Benchmarks for graphs
+****************************************************************/
+#include "common-bench.hpp"
+
+#include "graph-io.hpp"
+#include "graph.hpp"
+#include "mutable-graph.hpp"
+
+#include <map>
+#include <random>
+
+using namespace std;
+
+namespace bench {
+
+namespace {
+
+using Id = util::CsrGraph::Id;
+
+// R-MAT  generator  (Chakrabarti  et al.), which gives graphs with
+// the  skewed  (power-law)  degree distributions and small diame-
+// ters of real-world graphs: each edge is placed by recursively
+// choosing  one  quadrant  of  the adjacency matrix with probabil-
+// ities a, b, c, 1-a-b-c.
+util::CsrGraph make_rmat( int scale, size_t edges_per_node ) {
+    size_t const n = size_t( 1 ) << scale;
+    mt19937_64 rng( 42 );
+    uniform_real_distribution<double> d( 0.0, 1.0 );
+    vector<pair<Id, Id>> edges( n*edges_per_node );
+    for( auto& [from, to] : edges ) {
+        from = to = 0;
+        for( int bit = scale-1; bit >= 0; --bit ) {
+            double r = d( rng );
+            if( r < 0.57 )      {}
+            else if( r < 0.76 ) { to   |= Id( 1 ) << bit; }
+            else if( r < 0.95 ) { from |= Id( 1 ) << bit; }
+            else                { from |= Id( 1 ) << bit;
+                                  to   |= Id( 1 ) << bit; }
+        }
+    }
+    // Counting sort by source.
+    vector<uint32_t> offsets( n+1, 0 );
+    for( auto const& e : edges ) ++offsets[e.first+1];
+    for( size_t i = 0; i < n; ++i ) offsets[i+1] += offsets[i];
+    vector<Id> targets( edges.size() );
+    auto pos = offsets;
+    for( auto const& e : edges ) targets[pos[e.first]++] = e.second;
+    return util::CsrGraph( move( offsets ), move( targets ) );
+}
+
+util::CsrGraph const& rmat() {
+    static util::CsrGraph g = make_rmat( 18, 16 );
+    return g;
+}
+
+// Random DAG (edges only go from lower to higher numbered nodes)
+// as a map of named nodes.
+map<int, vector<int>> make_dag( int n, int edges_per_node ) {
+    mt19937 rng( 7 );
+    map<int, vector<int>> m;
+    for( int i = 0; i < n; ++i ) {
+        auto& out = m[i];
+        uniform_int_distribution<int> d( i+1, min( n-1, i+100 ) );
+        for( int j = 0; i < n-1 && j < edges_per_node; ++j )
+            out.push_back( d( rng ) );
+    }
+    return m;
+}
+
+map<string, vector<string>> make_named_dag( int n,
+                                            int edges_per_node ) {
+    map<string, vector<string>> res;
+    for( auto const& [from, tos] : make_dag( n, edges_per_node ) ) {
+        // Every node must be a key, even if it has no edges.
+        auto& out = res["node" + to_string( from )];
+        for( int to : tos )
+            out.push_back( "node" + to_string( to ) );
+    }
+    return res;
+}
+
+} // anonymous namespace
+
+// csr_reachable is a depth-first search; compare with the paral-
+// lel breadth-first search below, which finds the same nodes.
+BENCH( graph_dfs_serial )
+{
+    auto const& g  = rmat();
+    auto&       ws = util::thread_workspace();
+    while( state.loop() ) {
+        util::csr_reachable( g.view(), 0, ws );
+        do_not_optimize( ws.result );
+    }
+    state.set_items_per_iter( g.num_edges() );
+}
+
+BENCH( graph_bfs_par )
+{
+    auto const& g   = rmat();
+    auto        rev = g.reversed();
+    vector<Id>  out;
+    while( state.loop() ) {
+        util::csr_reachable_par( g.view(), [&]{ return rev.view(); },
+                                 0, 0, out );
+        do_not_optimize( out );
+    }
+    state.set_items_per_iter( g.num_edges() );
+}
+
+// The same search as graph_dfs_serial over a vector of vectors,
+// for comparison with the CSR layout.
+BENCH( graph_dfs_adjacency_list )
+{
+    auto const& g = rmat();
+    vector<vector<Id>> adj( g.num_nodes() );
+    for( Id n = 0; n < g.num_nodes(); ++n )
+        for( Id t : g.view().edges( n ) )
+            adj[n].push_back( t );
+    vector<bool> visited( adj.size() );
+    vector<Id>   stack, result;
+    while( state.loop() ) {
+        visited.assign( adj.size(), false );
+        result.clear();
+        stack.assign( 1, 0 );
+        visited[0] = true;
+        while( !stack.empty() ) {
+            Id v = stack.back();
+            stack.pop_back();
+            result.push_back( v );
+            for( Id t : adj[v] )
+                if( !visited[t] ) {
+                    visited[t] = true;
+                    stack.push_back( t );
+                }
+        }
+        do_not_optimize( result );
+    }
+    state.set_items_per_iter( g.num_edges() );
+}
+
+// Add an edge, query, and remove it again, incrementally...
+BENCH( mutable_graph_incremental )
+{
+    auto m = make_dag( 10000, 3 );
+    util::MutableGraph<int> g;
+    for( auto const& [from, tos] : m )
+        for( int to : tos )
+            g.add_edge( from, to );
+    mt19937 rng( 1 );
+    uniform_int_distribution<int> d( 0, 9998 );
+    while( state.loop() ) {
+        int from = d( rng );
+        int to   = from+1;
+        bool added = g.add_edge( from, to );
+        do_not_optimize( g.accessible( from/2 ) );
+        if( added ) g.remove_edge( from, to );
+    }
+}
+
+// ...and by rebuilding the immutable graph.
+BENCH( mutable_graph_rebuild )
+{
+    auto m = make_dag( 10000, 3 );
+    mt19937 rng( 1 );
+    uniform_int_distribution<int> d( 0, 9998 );
+    while( state.loop() ) {
+        int from = d( rng );
+        m[from].push_back( from+1 );
+        auto g = util::make_graph( m );
+        do_not_optimize( g.accessible( from/2 ) );
+        m[from].pop_back();
+    }
+}
+
+// Loading a saved graph and running a query...
+BENCH( graph_file_open )
+{
+    auto m = make_named_dag( 100000, 3 );
+    auto p = fs::temp_directory_path() / "cpp-bench-graph.bin";
+    util::write_graph( p, util::make_graph( m ) );
+    while( state.loop() ) {
+        util::MappedGraph g( p );
+        do_not_optimize( g.accessible( "node99000" ) );
+    }
+    fs::remove( p );
+}
+
+// ...versus building it from the map.
+BENCH( graph_make )
+{
+    auto m = make_named_dag( 100000, 3 );
+    while( state.loop() ) {
+        auto g = util::make_graph( m );
+        do_not_optimize( g.accessible( "node99000" ) );
+    }
+}
+
+} // namespace bench
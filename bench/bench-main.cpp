@@ -0,0 +1,169 @@
+/****************************************************************
+* Microbenchmark runner
+****************************************************************/
+#include "common-bench.hpp"
+#include "compare.hpp"
+#include "main.hpp"
+
+#include "logger.hpp"
+#include "string-util.hpp"
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <regex>
+#include <sstream>
+
+using namespace std;
+
+namespace bench {
+
+namespace {
+
+struct Options {
+    regex  filter{ ".*" };
+    int    samples         = 10;
+    double min_sample_secs = 0.05;
+    string json;
+    string baseline;
+    bool   list            = false;
+
+    CompareOptions compare;
+};
+
+Options parse_args( int argc, char** argv ) {
+    Options opts;
+    for( int i = 1; i < argc; ++i ) {
+        string_view a = argv[i];
+        auto value = [&]( string_view flag ) {
+            return string( a.substr( flag.size() ) );
+        };
+        if( util::starts_with( a, "--filter=" ) )
+            opts.filter = regex( value( "--filter=" ) );
+        else if( util::starts_with( a, "--samples=" ) )
+            opts.samples = util::stoi( value( "--samples=" ) );
+        else if( util::starts_with( a, "--min-time=" ) ) {
+            auto secs = util::parse<double>( value( "--min-time=" ) );
+            ASSERT( secs && *secs > 0, "invalid --min-time" );
+            opts.min_sample_secs = *secs;
+        } else if( util::starts_with( a, "--json=" ) )
+            opts.json = value( "--json=" );
+        else if( util::starts_with( a, "--compare=" ) )
+            opts.baseline = value( "--compare=" );
+        else if( util::starts_with( a, "--threshold=" ) ) {
+            auto pct = util::parse<double>( value( "--threshold=" ) );
+            ASSERT( pct && *pct >= 0, "invalid --threshold" );
+            opts.compare.threshold_pct = *pct;
+        } else if( util::starts_with( a, "--alpha=" ) ) {
+            auto alpha = util::parse<double>( value( "--alpha=" ) );
+            ASSERT( alpha && *alpha > 0 && *alpha < 1,
+                    "invalid --alpha" );
+            opts.compare.alpha = *alpha;
+        } else if( a == "--list" )
+            opts.list = true;
+        else
+            ERROR( "unknown option " << a << "; options are "
+                   "--filter=REGEX --samples=N --min-time=SECS "
+                   "--json=FILE --compare=FILE --threshold=PCT "
+                   "--alpha=P --list" );
+    }
+    ASSERT( opts.samples > 0, "--samples must be positive" );
+    return opts;
+}
+
+Result run( string const& name, BenchFunc* func, int64_t arg,
+            Options const& opts ) {
+    State state( arg, opts.min_sample_secs, opts.samples );
+    func( state );
+    ASSERT( state.samples().size() == size_t( opts.samples ),
+            "benchmark " << name << " did not run its loop to "
+            "completion" );
+    Result res;
+    res.name             = name;
+    res.iters_per_sample = state.iters_per_sample();
+    res.samples          = state.samples();
+    res.median           = median( res.samples );
+    res.mad              = mad( res.samples );
+    double iters_per_sec = res.median > 0 ? 1e9/res.median : 0;
+    res.bytes_per_sec    = double( state.bytes_per_iter() )*iters_per_sec;
+    res.items_per_sec    = double( state.items_per_iter() )*iters_per_sec;
+    return res;
+}
+
+void print( Result const& r ) {
+    ostringstream spread;
+    spread << "+-" << fixed << setprecision( 2 )
+           << (r.median > 0 ? 100*r.mad/r.median : 0) << "%";
+    cout << left << setw( 40 ) << r.name << right
+         << setw( 12 ) << human_ns( r.median )
+         << setw( 9 ) << spread.str()
+         << setw( 12 ) << r.iters_per_sample;
+    if( r.bytes_per_sec > 0 )
+        cout << "  " << human_rate( r.bytes_per_sec, "B" );
+    if( r.items_per_sec > 0 )
+        cout << "  " << human_rate( r.items_per_sec, " items" );
+    cout << "\n" << flush;
+}
+
+} // anonymous namespace
+
+} // namespace bench
+
+// This is the entrypoint for the benchmark executable. Results
+// saved  with  --json=FILE  can  serve  as  a baseline for a later
+// run with --compare=FILE, which then exits with a non-zero status
+// if any benchmark got significantly slower.
+int main_( int argc, char** argv )
+{
+    using namespace bench;
+
+    util::Logger::enabled = false;
+
+    auto opts = parse_args( argc, argv );
+
+    // Read it up front so as not to find out that it is missing
+    // only after running everything.
+    vector<Result> baseline;
+    if( !opts.baseline.empty() )
+        baseline = read_results( opts.baseline );
+
+    auto benches = bench_list();
+    sort( benches.begin(), benches.end(), []( auto& l, auto& r ){
+        return l.name < r.name;
+    });
+
+    vector<Result> results;
+    for( auto const& b : benches ) {
+        vector<pair<string, int64_t>> runs;
+        if( b.args.empty() )
+            runs.emplace_back( b.name, 0 );
+        for( auto arg : b.args )
+            runs.emplace_back( b.name + "/" + to_string( arg ), arg );
+        for( auto const& [name, arg] : runs ) {
+            if( !regex_search( name, opts.filter ) )
+                continue;
+            if( opts.list ) {
+                cout << name << "\n";
+                continue;
+            }
+            results.push_back( run( name, b.func, arg, opts ) );
+            print( results.back() );
+        }
+    }
+
+    if( !opts.json.empty() )
+        write_results( opts.json, results );
+
+    if( opts.baseline.empty() || opts.list )
+        return 0;
+
+    auto comps = compare( baseline, results, opts.compare );
+    cout << "\ncompared with " << opts.baseline << ":\n";
+    print( comps );
+    auto slower = count_if( comps.begin(), comps.end(), []( auto& c ){
+        return c.verdict == Verdict::slower;
+    });
+    if( slower > 0 )
+        cerr << slower << " benchmark(s) regressed.\n";
+    return slower > 0 ? 1 : 0;
+}
@@ -0,0 +1,23 @@
+/****************************************************************
+* Benchmarks for md5
+****************************************************************/
+#include "common-bench.hpp"
+
+#include "md5-util.hpp"
+
+using namespace std;
+
+namespace bench {
+
+BENCH( md5 )
+{
+    vector<char> data( 1 << 20 );
+    for( size_t i = 0; i < data.size(); ++i )
+        data[i] = char( i*31 );
+
+    while( state.loop() )
+        do_not_optimize( crypto::md5( data ) );
+    state.set_bytes_per_iter( data.size() );
+}
+
+} // namespace bench
@@ -0,0 +1,33 @@
+/****************************************************************
+* Benchmarks for sqlite utilities
+****************************************************************/
+#include "common-bench.hpp"
+
+#include "sqlite-util.hpp"
+
+using namespace std;
+
+namespace bench {
+
+BENCH( insert_many_fast )
+{
+    sqlite::database db = sqlite::open( { ":memory:", "", false } );
+    db << "CREATE TABLE user (_id INTEGER PRIMARY KEY, "
+          "age INTEGER, name TEXT, weight REAL);";
+
+    vector<tuple<int, int, string, double>> rows;
+    for( int i = 0; i < 10000; ++i )
+        rows.emplace_back( i, 20 + i%50, "user" + to_string( i ),
+                           50.0 + i%40 );
+
+    while( state.loop() ) {
+        sqlite::insert_many_fast( db, rows,
+            "INSERT INTO user (_id, age, name, weight) VALUES" );
+        state.pause();
+        db << "DELETE FROM user;";
+        state.resume();
+    }
+    state.set_items_per_iter( rows.size() );
+}
+
+} // namespace bench
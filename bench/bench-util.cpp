@@ -0,0 +1,135 @@
+/****************************************************************
+* Benchmarks for general utilities
+****************************************************************/
+#include "common-bench.hpp"
+
+#include "datetime.hpp"
+#include "fs.hpp"
+#include "io.hpp"
+#include "string-util.hpp"
+
+#include <sstream>
+#include <tuple>
+
+using namespace std;
+
+namespace bench {
+
+BENCH( read_file )
+{
+    auto p = fs::temp_directory_path() / "cpp-bench-read-file.txt";
+    string line( 79, 'x' );
+    line += '\n';
+    vector<char> data;
+    for( int i = 0; i < 1 << 14; ++i )
+        data.insert( data.end(), line.begin(), line.end() );
+    util::write_file( p, data );
+
+    while( state.loop() )
+        do_not_optimize( util::read_file( p ) );
+    state.set_bytes_per_iter( data.size() );
+    fs::remove( p );
+}
+
+BENCH( split )
+{
+    string s;
+    for( int i = 0; i < 10000; ++i )
+        s += "field" + to_string( i ) + ",";
+
+    while( state.loop() )
+        do_not_optimize( util::split( s, ',' ) );
+    state.set_bytes_per_iter( s.size() );
+}
+
+BENCH( lexically_normal )
+{
+    fs::path p = "a/b/../c/./d//e/../../f/g/h/./../i.txt";
+    while( state.loop() )
+        do_not_optimize( util::lexically_normal( p ) );
+}
+
+BENCH( fmt_time )
+{
+    auto t = chrono::system_clock::now();
+    while( state.loop() )
+        do_not_optimize( util::fmt_time( t ) );
+}
+
+namespace {
+
+vector<tuple<int, string, double>> make_rows() {
+    vector<tuple<int, string, double>> rows;
+    for( int i = 0; i < 1000; ++i )
+        rows.emplace_back( i, "name" + to_string( i ), i*1.5 );
+    return rows;
+}
+
+} // anonymous namespace
+
+BENCH( to_string_rows )
+{
+    auto rows = make_rows();
+    while( state.loop() )
+        do_not_optimize( util::to_string( rows ) );
+    state.set_items_per_iter( rows.size() );
+}
+
+BENCH( format_to_rows )
+{
+    auto rows = make_rows();
+    util::FmtBuffer buf;
+    while( state.loop() ) {
+        // Reusing the buffer, as insert_many_fast does.
+        buf.clear();
+        util::format_to( buf, rows );
+        do_not_optimize( buf );
+    }
+    state.set_items_per_iter( rows.size() );
+}
+
+namespace {
+
+vector<string> make_numbers() {
+    vector<string> res;
+    for( int i = 0; i < 1000; ++i )
+        res.push_back( to_string( i*7919 - 3000000 ) );
+    return res;
+}
+
+} // anonymous namespace
+
+BENCH( parse_int )
+{
+    auto nums = make_numbers();
+    while( state.loop() )
+        for( auto const& s : nums )
+            do_not_optimize( util::parse<int>( s ) );
+    state.set_items_per_iter( nums.size() );
+}
+
+BENCH( parse_int_stream )
+{
+    auto nums = make_numbers();
+    while( state.loop() )
+        for( auto const& s : nums ) {
+            istringstream in( s );
+            int n = 0;
+            in >> n;
+            do_not_optimize( n );
+        }
+    state.set_items_per_iter( nums.size() );
+}
+
+BENCH( iequals )
+{
+    string a = "Some/Mixed/Case/Path/To/A/File.TXT";
+    string b = "some/mixed/case/path/to/a/file.txt";
+    while( state.loop() ) {
+        do_not_optimize( util::iequals( a, b ) );
+        clobber_memory();
+    }
+    state.set_bytes_per_iter( a.size() );
+}
+
+} // namespace bench
@@ -0,0 +1,131 @@
+/****************************************************************
+* Microbenchmark infrastructure
+****************************************************************/
+#include "common-bench.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+
+using namespace std;
+
+namespace bench {
+
+namespace {
+
+// Formats with units chosen for readability.
+string human( double v, vector<pair<double, char const*>> const& units ) {
+    auto u = units[0];
+    for( auto const& p : units )
+        if( v >= p.first ) u = p;
+    ostringstream out;
+    out << fixed << setprecision( 2 ) << v/u.first << u.second;
+    return out.str();
+}
+
+} // anonymous namespace
+
+string human_ns( double ns ) {
+    return human( ns, { { 1, "ns" }, { 1e3, "us" }, { 1e6, "ms" },
+                        { 1e9, "s" } } );
+}
+
+string human_rate( double per_sec, char const* what ) {
+    return human( per_sec, { { 1, "" }, { 1e3, "K" }, { 1e6, "M" },
+                             { 1e9, "G" } } ) + what + "/s";
+}
+
+State::State( int64_t arg, double min_sample_secs, int samples )
+    : m_arg( arg ),
+      m_min_sample_secs( min_sample_secs ),
+      m_num_samples( samples ),
+      m_phase( Phase::start ),
+      m_batch( 1 ),
+      m_remaining( 0 ),
+      m_batch_start(),
+      m_pause_start(),
+      m_paused( 0 ),
+      m_samples(),
+      m_bytes_per_iter( 0 ),
+      m_items_per_iter( 0 ) {}
+
+void State::pause() { m_pause_start = clock::now(); }
+
+void State::resume() { m_paused += clock::now() - m_pause_start; }
+
+double State::batch_secs() const {
+    return chrono::duration<double>(
+        clock::now() - m_batch_start - m_paused ).count();
+}
+
+bool State::next_batch() {
+    double secs = batch_secs();
+    switch( m_phase ) {
+        case Phase::start:
+            m_phase = Phase::calibrate;
+            break;
+        case Phase::warmup:
+            // If  the  last calibration batch was slowed by noise
+            // (e.g. the thread being preempted) then the warmup, of
+            // the  same  size,  falls well short of the minimum; go
+            // back to calibrating in that case.
+            if( secs >= m_min_sample_secs/2 ) {
+                m_phase = Phase::measure;
+                break;
+            }
+            m_phase = Phase::calibrate;
+            [[fallthrough]];
+        case Phase::calibrate:
+            if( secs >= m_min_sample_secs ) {
+                m_phase = Phase::warmup;
+                break;
+            }
+            // Aim a bit past the minimum, growing by at most 10x
+            // at a time in case the first iterations were unusually
+            // fast (e.g. a lazily-built cache).
+            m_batch = uint64_t( double( m_batch ) * min( 10.0,
+                max( 1.5, 1.2*m_min_sample_secs/max( secs, 1e-9 ) ) ) );
+            break;
+        case Phase::measure:
+            m_samples.push_back( secs*1e9/double( m_batch ) );
+            if( m_samples.size() == size_t( m_num_samples ) ) {
+                m_phase = Phase::done;
+                return false;
+            }
+            break;
+        case Phase::done:
+            return false;
+    }
+    // This call counts as the first iteration of the batch.
+    m_remaining   = m_batch-1;
+    m_paused      = clock::duration( 0 );
+    m_batch_start = clock::now();
+    return true;
+}
+
+vector<Benchmark>& bench_list() {
+    static vector<Benchmark> g_benches;
+    return g_benches;
+}
+
+double median( vector<double> v ) {
+    if( v.empty() )
+        return 0;
+    auto mid = v.begin() + v.size()/2;
+    nth_element( v.begin(), mid, v.end() );
+    if( v.size() % 2 == 1 )
+        return *mid;
+    return (*mid + *max_element( v.begin(), mid ))/2;
+}
+
+double mad( vector<double> const& v ) {
+    double m = median( v );
+    vector<double> dev;
+    dev.reserve( v.size() );
+    for( double x : v )
+        dev.push_back( fabs( x-m ) );
+    return median( move( dev ) );
+}
+
+} // namespace bench
@@ -0,0 +1,171 @@
+/****************************************************************
+* Microbenchmark infrastructure
+****************************************************************/
+#pragma once
+
+#include "macros.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace bench {
+
+/****************************************************************
+* State
+*
+* Passed  to  each benchmark function, which does any setup that
+* it needs and then runs the code to be measured in a loop:
+*
+*   BENCH( split ) {
+*       string s = ...;                  // setup, not timed
+*       while( state.loop() )
+*           do_not_optimize( util::split( s, ',' ) );
+*       state.set_bytes_per_iter( s.size() );
+*   }
+*
+* The function is called only once (so setup is done only once,
+* however  expensive);  loop()  drives  all of the runs: first a
+* calibration  phase  that  finds  how many iterations take about
+* the  minimum  time  for  one  sample,  then a warmup sample that
+* is  discarded (and that restarts the calibration if it is much
+* shorter than expected), then the requested number of samples,
+* each timed separately so that their spread can be reported.
+*
+* Code  inside  the  loop  that should not be timed (e.g. resetting
+* some input) can be bracketed with pause() and resume().
+****************************************************************/
+class State {
+
+public:
+    State( int64_t arg, double min_sample_secs, int samples );
+
+    // True while the body of the loop should run again. Only the
+    // counter decrement is inline.
+    bool loop() {
+        if( m_remaining > 0 ) {
+            --m_remaining;
+            return true;
+        }
+        return next_batch();
+    }
+
+    void pause();
+    void resume();
+
+    // The argument for benchmarks registered with BENCH_ARGS.
+    int64_t arg() const { return m_arg; }
+
+    // For reporting throughput.
+    void set_bytes_per_iter( uint64_t n ) { m_bytes_per_iter = n; }
+    void set_items_per_iter( uint64_t n ) { m_items_per_iter = n; }
+
+    // Nanoseconds per iteration of each sample.
+    std::vector<double> const& samples() const { return m_samples; }
+    uint64_t iters_per_sample() const { return m_batch; }
+    uint64_t bytes_per_iter()   const { return m_bytes_per_iter; }
+    uint64_t items_per_iter()   const { return m_items_per_iter; }
+
+private:
+    using clock = std::chrono::steady_clock;
+
+    enum class Phase { start, calibrate, warmup, measure, done };
+
+    // Called when a batch of iterations has finished: records it
+    // and sets up the next one, returning false if there is none.
+    bool next_batch();
+
+    // Seconds taken by the batch that just finished, not counting
+    // paused time.
+    double batch_secs() const;
+
+    int64_t             m_arg;
+    double              m_min_sample_secs;
+    int                 m_num_samples;
+    Phase               m_phase;
+    uint64_t            m_batch;
+    uint64_t            m_remaining;
+    clock::time_point   m_batch_start;
+    clock::time_point   m_pause_start;
+    clock::duration     m_paused;
+    std::vector<double> m_samples;
+    uint64_t            m_bytes_per_iter;
+    uint64_t            m_items_per_iter;
+};
+
+// Prevents the compiler from optimizing away the computation of
+// a value that is otherwise unused.
+template<typename T>
+inline void do_not_optimize( T const& value ) {
+#ifdef __GNUC__
+    asm volatile( "" : : "r,m"( value ) : "memory" );
+#else
+    static volatile char const* sink;
+    sink = reinterpret_cast<char const volatile*>( &value );
+#endif
+}
+
+// Prevents the compiler from assuming that memory is unchanged
+// across this point, or from dropping writes made before it.
+inline void clobber_memory() {
+#ifdef __GNUC__
+    asm volatile( "" : : : "memory" );
+#endif
+}
+
+using BenchFunc = void( State& );
+
+struct Benchmark {
+    std::string          name;
+    BenchFunc*           func;
+    // Run once per argument (if any), with name "name/arg".
+    std::vector<int64_t> args;
+};
+
+// Global benchmark list: benchmarks are automatically registered
+// and added to this list at static initialization time.
+std::vector<Benchmark>& bench_list();
+
+struct Result {
+    std::string         name;
+    uint64_t            iters_per_sample;
+    // Nanoseconds per iteration.
+    std::vector<double> samples;
+    double              median;
+    // Median absolute deviation from the median.
+    double              mad;
+    // Zero if not set by the benchmark.
+    double              bytes_per_sec;
+    double              items_per_sec;
+};
+
+double median( std::vector<double> v );
+double mad( std::vector<double> const& v );
+
+// Formats a time with units chosen for readability, e.g. "1.25ms".
+std::string human_ns( double ns );
+
+// E.g. human_rate( 2.5e6, "B" ) == "2.50MB/s".
+std::string human_rate( double per_sec, char const* what );
+
+} // namespace bench
+
+// Registers  a benchmark; the body that follows receives a State
+// named `state`. The anonymous namespace is for the same  reason
+// as in the TEST macro.
+#define BENCH( a ) BENCH_ARGS( a )
+
+// Same,  but run once for each of the given integer arguments,
+// which are available through state.arg().
+#define BENCH_ARGS( a, ... )                                    \
+    void STRING_JOIN( bench_, a )( bench::State& state );       \
+    namespace {                                                 \
+        STARTUP() {                                             \
+            bench::bench_list().push_back( bench::Benchmark{    \
+                TO_STRING( a ), STRING_JOIN( bench_, a ),       \
+                { __VA_ARGS__ } } );                            \
+        }                                                       \
+    }                                                           \
+    void STRING_JOIN( bench_, a )( [[maybe_unused]]             \
+                                   bench::State& state )
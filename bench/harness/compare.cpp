@@ -0,0 +1,333 @@
+/****************************************************************
+* Comparison of benchmark results against a baseline
+****************************************************************/
+#include "compare.hpp"
+
+#include "io.hpp"
+#include "macros.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <sstream>
+#include <unordered_map>
+
+using namespace std;
+
+namespace bench {
+
+namespace {
+
+/****************************************************************
+* Results file reader
+*
+* Just enough JSON to read back what write_results produces: any
+* value can be skipped, but strings may only have simple escapes.
+****************************************************************/
+class JsonReader {
+
+public:
+    JsonReader( string_view text, string const& file )
+        : m_text( text ), m_pos( 0 ), m_file( file ) {}
+
+    void ws() {
+        while( m_pos < m_text.size() &&
+               isspace( (unsigned char)m_text[m_pos] ) )
+            ++m_pos;
+    }
+
+    char peek() {
+        ws();
+        ASSERT( m_pos < m_text.size(), m_file << ": unexpected end "
+                "of file" );
+        return m_text[m_pos];
+    }
+
+    void expect( char c ) {
+        ASSERT( peek() == c, m_file << ": expected '" << c << "' at "
+                "offset " << m_pos << " but found '" << m_text[m_pos]
+                << "'" );
+        ++m_pos;
+    }
+
+    // Consumes c if it is next.
+    bool accept( char c ) {
+        if( peek() != c )
+            return false;
+        ++m_pos;
+        return true;
+    }
+
+    string str() {
+        expect( '"' );
+        string res;
+        while( m_pos < m_text.size() && m_text[m_pos] != '"' ) {
+            if( m_text[m_pos] == '\\' ) ++m_pos;
+            if( m_pos < m_text.size() ) res += m_text[m_pos++];
+        }
+        expect( '"' );
+        return res;
+    }
+
+    double number() {
+        ws();
+        char const* start = m_text.data() + m_pos;
+        char*       end   = nullptr;
+        double      res   = strtod( start, &end );
+        ASSERT( end != start, m_file << ": expected a number at "
+                "offset " << m_pos );
+        m_pos += size_t( end - start );
+        return res;
+    }
+
+    // Calls f() for each element of an array.
+    template<typename F>
+    void array( F f ) {
+        expect( '[' );
+        if( accept( ']' ) )
+            return;
+        do f(); while( accept( ',' ) );
+        expect( ']' );
+    }
+
+    // Calls f( key ) for each member of an object; f must consume
+    // the value.
+    template<typename F>
+    void object( F f ) {
+        expect( '{' );
+        if( accept( '}' ) )
+            return;
+        do {
+            auto key = str();
+            expect( ':' );
+            f( key );
+        } while( accept( ',' ) );
+        expect( '}' );
+    }
+
+    void skip_value() {
+        switch( peek() ) {
+            case '{': object( [this]( auto& ){ skip_value(); } ); break;
+            case '[': array( [this]{ skip_value(); } );            break;
+            case '"': str();                                       break;
+            default:
+                // Numbers and the literals true/false/null.
+                while( m_pos < m_text.size() &&
+                       !strchr( ",]} \t\r\n", m_text[m_pos] ) )
+                    ++m_pos;
+        }
+    }
+
+private:
+    string_view   m_text;
+    size_t        m_pos;
+    string const& m_file;
+};
+
+/****************************************************************
+* Mann-Whitney U
+****************************************************************/
+// Number of orderings of n1 a's and n2 b's in which exactly u
+// (a, b) pairs have the a first, for each u in [0, n1*n2]. Built
+// up by conditioning on whether the last element is an a (which
+// then comes after all n2 b's) or a b.
+vector<double> u_counts( size_t n1, size_t n2 ) {
+    // table[i][j] holds the counts for i a's and j b's, each a
+    // vector indexed by u.
+    vector<vector<vector<double>>> table( n1+1,
+        vector<vector<double>>( n2+1 ) );
+    for( size_t i = 0; i <= n1; ++i ) {
+        for( size_t j = 0; j <= n2; ++j ) {
+            auto& cur = table[i][j];
+            cur.assign( i*j+1, 0.0 );
+            if( i == 0 || j == 0 ) {
+                cur[0] = 1;
+                continue;
+            }
+            auto const& last_a = table[i-1][j];
+            auto const& last_b = table[i][j-1];
+            for( size_t u = 0; u < last_a.size(); ++u )
+                cur[u+j] += last_a[u];
+            for( size_t u = 0; u < last_b.size(); ++u )
+                cur[u] += last_b[u];
+        }
+    }
+    return move( table[n1][n2] );
+}
+
+// Above this the normal approximation is good enough (and the
+// exact table gets large).
+constexpr size_t max_exact_samples = 20;
+
+} // anonymous namespace
+
+void write_results( string const& file,
+                    vector<Result> const& results ) {
+    ofstream out( file );
+    ASSERT( out.good(), "failed to open " << file );
+    out << setprecision( 10 );
+    out << "{\n  \"benchmarks\": [";
+    bool first = true;
+    for( auto const& r : results ) {
+        out << (first ? "\n" : ",\n");
+        first = false;
+        out << "    {\n"
+            << "      \"name\": \"" << r.name << "\",\n"
+            << "      \"iters_per_sample\": " << r.iters_per_sample
+            << ",\n"
+            << "      \"median_ns\": " << r.median << ",\n"
+            << "      \"mad_ns\": " << r.mad << ",\n"
+            << "      \"bytes_per_second\": " << r.bytes_per_sec
+            << ",\n"
+            << "      \"items_per_second\": " << r.items_per_sec
+            << ",\n"
+            << "      \"samples_ns\": [";
+        for( size_t i = 0; i < r.samples.size(); ++i )
+            out << (i ? ", " : "") << r.samples[i];
+        out << "]\n    }";
+    }
+    out << "\n  ]\n}\n";
+}
+
+vector<Result> read_results( string const& file ) {
+    auto       text = util::read_file_str( file );
+    JsonReader json( text, file );
+    vector<Result> res;
+    json.object( [&]( string const& key ) {
+        if( key != "benchmarks" ) {
+            json.skip_value();
+            return;
+        }
+        json.array( [&] {
+            Result r{};
+            json.object( [&]( string const& field ) {
+                if( field == "name" )
+                    r.name = json.str();
+                else if( field == "samples_ns" )
+                    json.array( [&] {
+                        r.samples.push_back( json.number() );
+                    });
+                else
+                    json.skip_value();
+            });
+            ASSERT( !r.name.empty(), file << ": benchmark has no name" );
+            r.median = median( r.samples );
+            r.mad    = mad( r.samples );
+            res.push_back( move( r ) );
+        });
+    });
+    return res;
+}
+
+double mann_whitney_p( vector<double> const& a,
+                       vector<double> const& b ) {
+    size_t n1 = a.size(), n2 = b.size(), n = n1+n2;
+    if( n1 == 0 || n2 == 0 )
+        return 1.0;
+
+    // Rank the pooled samples, giving tied values their average
+    // rank.
+    vector<pair<double, bool>> pooled; // (value, is from a)
+    pooled.reserve( n );
+    for( double x : a ) pooled.emplace_back( x, true );
+    for( double x : b ) pooled.emplace_back( x, false );
+    sort( pooled.begin(), pooled.end() );
+    double rank_sum_a = 0, tie_term = 0;
+    for( size_t i = 0; i < n; ) {
+        size_t j = i;
+        while( j < n && pooled[j].first == pooled[i].first ) ++j;
+        double t    = double( j-i );
+        double rank = double( i+j+1 )/2; // 1-based average
+        for( size_t k = i; k < j; ++k )
+            if( pooled[k].second ) rank_sum_a += rank;
+        tie_term += t*t*t - t;
+        i = j;
+    }
+    double u    = rank_sum_a - double( n1*(n1+1) )/2;
+    double mean = double( n1*n2 )/2;
+
+    if( n1 <= max_exact_samples && n2 <= max_exact_samples &&
+        tie_term == 0 ) {
+        auto   counts = u_counts( n1, n2 );
+        double total  = accumulate( counts.begin(), counts.end(), 0.0 );
+        // U is symmetric about its mean, so take the tail on the
+        // side that u is on and double it.
+        auto   k      = size_t( min( u, double( n1*n2 )-u ) );
+        double tail   = accumulate( counts.begin(),
+                                    counts.begin()+k+1, 0.0 );
+        return min( 1.0, 2*tail/total );
+    }
+
+    double var = double( n1*n2 )/12 *
+                 (double( n+1 ) - tie_term/double( n*(n-1) ));
+    if( var <= 0 )
+        return 1.0; // All values equal.
+    // With continuity correction.
+    double z = max( 0.0, fabs( u-mean ) - 0.5 )/sqrt( var );
+    return erfc( z/sqrt( 2.0 ) );
+}
+
+vector<Comparison> compare( vector<Result> const& base,
+                            vector<Result> const& current,
+                            CompareOptions const& opts ) {
+    unordered_map<string, Result const*> by_name;
+    for( auto const& r : base )
+        by_name[r.name] = &r;
+    vector<Comparison> res;
+    for( auto const& r : current ) {
+        Comparison c{ r.name, 0, r.median, 0, 1.0, Verdict::added };
+        if( auto it = by_name.find( r.name ); it != by_name.end() ) {
+            auto const& b = *it->second;
+            c.base    = b.median;
+            c.change  = b.median > 0 ? 100*(r.median/b.median - 1) : 0;
+            c.p_value = mann_whitney_p( b.samples, r.samples );
+            c.verdict = Verdict::same;
+            if( c.p_value < opts.alpha &&
+                fabs( c.change ) > opts.threshold_pct )
+                c.verdict = c.change > 0 ? Verdict::slower
+                                         : Verdict::faster;
+        }
+        res.push_back( move( c ) );
+    }
+    return res;
+}
+
+void print( vector<Comparison> const& comps ) {
+    cout << left << setw( 40 ) << "benchmark" << right
+         << setw( 12 ) << "base" << setw( 12 ) << "new"
+         << setw( 10 ) << "change" << setw( 9 ) << "p"
+         << "  verdict\n";
+    for( auto const& c : comps ) {
+        cout << left << setw( 40 ) << c.name << right;
+        if( c.verdict == Verdict::added ) {
+            cout << setw( 12 ) << "-" << setw( 12 )
+                 << human_ns( c.current ) << setw( 10 ) << "-"
+                 << setw( 9 ) << "-" << "  added\n";
+            continue;
+        }
+        ostringstream change, p;
+        change << showpos << fixed << setprecision( 1 ) << c.change
+               << "%";
+        p << fixed << setprecision( 3 ) << c.p_value;
+        cout << setw( 12 ) << human_ns( c.base )
+             << setw( 12 ) << human_ns( c.current )
+             << setw( 10 ) << change.str() << setw( 9 ) << p.str()
+             << "  ";
+        switch( c.verdict ) {
+            case Verdict::same:   cout << "~";      break;
+            case Verdict::faster: cout << "FASTER"; break;
+            case Verdict::slower: cout << "SLOWER"; break;
+            case Verdict::added:                    break;
+        }
+        cout << "\n";
+    }
+    cout << flush;
+}
+
+} // namespace bench
@@ -0,0 +1,64 @@
+/****************************************************************
+* Comparison of benchmark results against a baseline
+****************************************************************/
+#pragma once
+
+#include "common-bench.hpp"
+
+#include <string>
+#include <vector>
+
+namespace bench {
+
+// Saves results as JSON (this is what --json does), including all
+// of the samples so that a later run can be compared against them.
+void write_results( std::string const&         file,
+                    std::vector<Result> const& results );
+
+// Reads the results saved by write_results. Only the name and
+// samples  of  each benchmark are read back (the other fields are
+// derived from them); median and mad are recomputed.
+std::vector<Result> read_results( std::string const& file );
+
+// Two-sided p-value of the Mann-Whitney U test for the null hypo-
+// thesis  that  the  two  sets of samples come from the same dis-
+// tribution. Makes no assumption about the shape of the distribu-
+// tions (timings are typically skewed, with a long tail), only
+// that  the samples are independent. Uses the exact distribution
+// of  U  when  both  sets  are  small  and  there are no ties,
+// otherwise the normal approximation with tie correction.
+double mann_whitney_p( std::vector<double> const& a,
+                       std::vector<double> const& b );
+
+enum class Verdict { same, faster, slower, added };
+
+struct Comparison {
+    std::string name;
+    // Median ns per iteration; base is zero when verdict is added.
+    double      base;
+    double      current;
+    // Percentage change in median time; positive is slower.
+    double      change;
+    double      p_value;
+    Verdict     verdict;
+};
+
+struct CompareOptions {
+    // Significance level of the test.
+    double alpha         = 0.05;
+    // A change must also exceed this percentage of the baseline
+    // median to be reported, since with enough samples the test
+    // will  pick  up  differences that are too small to matter.
+    double threshold_pct = 5.0;
+};
+
+// One entry per result, in the same order. Baseline results with
+// no counterpart in `current` (e.g. filtered out) are ignored.
+std::vector<Comparison> compare( std::vector<Result> const& base,
+                                 std::vector<Result> const& current,
+                                 CompareOptions const& opts );
+
+// Prints a table of the comparisons.
+void print( std::vector<Comparison> const& comps );
+
+} // namespace bench
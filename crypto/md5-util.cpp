@@ -3,6 +3,8 @@
 ****************************************************************/
 #include "md5-util.hpp"
 
+#include "latency.hpp"
+
 using namespace std;
 
 namespace crypto {
@@ -25,6 +27,9 @@ string md5( string const& s ) {
 // correct md5 sum for a zero length string.
 string md5( char const* bytes, size_t len ) {
 
+    static auto& hist = util::latency_histogram( "crypto::md5" );
+    TIMED_SCOPE( hist );
+
 	md5::md5_t md5;
 	md5.process( bytes, len );
 	md5.finish();
@@ -87,6 +87,19 @@ std::string impl::to_string( ZonedTimePoint const& p ) {
     return "\""s + util::to_string( p ) + "\"";
 }
 
+void impl::format_to( util::FmtBuffer& buf, SysTimePoint const& p ) {
+    buf += '"';
+    buf += util::to_string( p );
+    buf += '"';
+}
+
+void impl::format_to( util::FmtBuffer&      buf,
+                      ZonedTimePoint const& p ) {
+    buf += '"';
+    buf += util::to_string( p );
+    buf += '"';
+}
+
 // Attach to an existing connection.
 void attach( sqlite::database& db, DBDescVec const& dbs ) {
 
@@ -5,6 +5,7 @@
 
 #include "datetime.hpp"
 #include "fs.hpp"
+#include "latency.hpp"
 #include "sqlite_modern_cpp.h"
 #include "string-util.hpp"
 #include "types.hpp"
@@ -80,30 +81,98 @@ std::string to_string( SysTimePoint const& p );
 template<>
 std::string to_string( ZonedTimePoint const& p );
 
+// These  are  the  format_to counterparts of the above to_string
+// functions:  they produce the same output, but append it to the
+// end of the given buffer. They are used when building large  in-
+// sert queries so that all of the values can be formatted into  a
+// single query string without creating any temporary strings.
+template<typename T>
+void format_to( util::FmtBuffer& buf, T const& what ) {
+    // Default case, just delegate.
+    util::format_to( buf, what );
+}
+
+// We  need  special  SQL-specifc  behavior for the std::optional.
+template<typename T>
+void format_to( util::FmtBuffer&        buf,
+                std::optional<T> const& what ) {
+    if( !what )
+        buf += "NULL";
+    else
+        util::format_to( buf, *what );
+}
+
+void format_to( util::FmtBuffer& buf, SysTimePoint   const& p );
+void format_to( util::FmtBuffer& buf, ZonedTimePoint const& p );
+
 // This function exists for the purpose of  having  the  compiler
 // deduce the Indexes variadic integer arguments that we can then
 // use to index the tuple; it probably is not useful to call this
-// method directly (it is called by to_string).
+// method directly (it is called by format_to).
 template<typename Tuple, size_t... Indexes>
-StrVec tuple_elems_to_string( Tuple const& tp,
-                              std::index_sequence<Indexes...> ) {
-    StrVec res; res.reserve( std::tuple_size_v<Tuple> );
+void tuple_elems_format_to( util::FmtBuffer& buf,
+                            Tuple const&     tp,
+                            std::index_sequence<Indexes...> ) {
     namespace N = ::sqlite::impl;
     // Unary  right  fold  of  template parameter pack. NOTE: the
-    // to_string  method  used  here  is  the  one in this module.
-    ((res.push_back( N::to_string( std::get<Indexes>( tp ) ))), ...);
-    return res;
+    // format_to  method  used  here  is  the  one in this module.
+    ((buf.append( Indexes == 0 ? 0 : 1, ',' ),
+      N::format_to( buf, std::get<Indexes>( tp ) )), ...);
 }
 
 // Will do JSON-like notation.  E.g.  (1,"hello",2),  however  it
-// calls impl::to_string (in this module) so that components that
+// calls impl::format_to (in this module) so that components that
 // are optional will be properly converted  to "NULL" if they are
 // nullopt.
 template<typename... Args>
-std::string to_string( std::tuple<Args...> const& tp ) {
+void format_to( util::FmtBuffer&           buf,
+                std::tuple<Args...> const& tp ) {
     auto is = std::make_index_sequence<sizeof...(Args)>();
-    auto v = ::sqlite::impl::tuple_elems_to_string( tp, is );
-    return "(" + util::join( v, "," ) + ")";
+    buf += '(';
+    ::sqlite::impl::tuple_elems_format_to( buf, tp, is );
+    buf += ')';
+}
+
+template<typename... Args>
+std::string to_string( std::tuple<Args...> const& tp ) {
+    std::string res;
+    res.reserve( util::estimate_size( tp ) );
+    ::sqlite::impl::format_to( res, tp );
+    return res;
+}
+
+// Runs the query (which should end just before the list of  value
+// tuples)  with  the elements of `in` appended to it, doing so in
+// chunks to avoid exceeding sqlite's  maximum  query length. The
+// function  `fmt`  is  called for each element and must append a
+// tuple (with parenthesis) to the buffer given to it. The  query
+// buffer is reused between chunks.
+template<typename T, typename Func>
+void insert_chunked( sqlite::database&     db,
+                     std::vector<T> const& in,
+                     std::string const&    query,
+                     Func                  fmt ) {
+    // Shared by all the insert_many_fast overloads.
+    static auto& hist =
+        util::latency_histogram( "sqlite::insert_many_fast" );
+    TIMED_SCOPE( hist );
+    std::string q;
+    for( auto& p : util::chunks( in.size(), chunk ) ) {
+        // clang seems to give an `unused variable' warning if we
+        // put this structured  binding  in  the  for  loop  (?!).
+        auto const& [l,r] = p;
+        q.assign( query );
+        q += ' ';
+        // l,r are offsets from beginning of vector, and r  is  a
+        // one-past-the-end offset.
+        for( size_t i = l; i < r; ++i ) {
+            if( i != l )
+                q += ',';
+            fmt( q, in[i] );
+        }
+        // Insert all elements in one shot.
+        db << q;
+    }
 }
 
 // This is a helper function that accepts a tuple as an  (unused)
@@ -408,27 +477,12 @@ void insert_many_fast( sqlite::database&  db,
 
     using Tp = std::tuple<Args...>;
 
-    // We  need  this lambda to help std::transform with overload
-    // resolution of to_string.
-    auto f = []( Tp const& e ){ return impl::to_string( e ); };
-
-    // Do  the  entire  operation  in  chunks  to avoid exceeding
-    // sqlite's maximum query length.
-    for( auto& p : util::chunks( in.size(), impl::chunk ) ) {
-        // clang seems to give an `unused variable' warning if we
-        // put this structured  binding  in  the  for  loop  (?!).
-        auto const& [l,r] = p;
-        // This is the number  of  elements  in this chunk, which
-        // may  be less than impl::chunk if we're on the last one.
-        std::vector<std::string> strs( r-l );
-        // l,r are offsets from beginning of vector, and r  is  a
-        // one-past-the-end offset.
-        std::transform( std::begin( in )+l, std::begin( in )+r,
-                        std::begin( strs ), f );
+    // Each tuple is formatted straight into the query buffer.
+    auto f = []( util::FmtBuffer& buf, Tp const& e ){
+        impl::format_to( buf, e );
+    };
 
-        // Insert all elements in one shot.
-        db << (query + " " + util::join( strs, "," ));
-    }
+    impl::insert_chunked( db, in, query, f );
 }
 
 // This overload is for  the  general  case  when  the caller can
@@ -456,23 +510,11 @@ void insert_many_fast( sqlite::database&     db,
                        std::string const&    query,
                        Func                  func ) {
 
-    // Do  the  entire  operation  in  chunks  to avoid exceeding
-    // sqlite's maximum query length.
-    for( auto& p : util::chunks( in.size(), impl::chunk ) ) {
-        // clang seems to give an `unused variable' warning if we
-        // put this structured  binding  in  the  for  loop  (?!).
-        auto const& [l,r] = p;
-        // This is the number  of  elements  in this chunk, which
-        // may  be less than impl::chunk if we're on the last one.
-        std::vector<std::string> strs( r-l );
-        // l,r are offsets from beginning of vector, and r  is  a
-        // one-past-the-end offset.
-        std::transform( std::begin( in )+l, std::begin( in )+r,
-                        std::begin( strs ), func );
+    auto f = [&func]( util::FmtBuffer& buf, T const& e ){
+        buf += func( e );
+    };
 
-        // Insert all elements in one shot.
-        db << (query + " " + util::join( strs, "," ));
-    }
+    impl::insert_chunked( db, in, query, f );
 }
 
 // This is a variant of the above for the simple  case  that  the
@@ -482,8 +524,13 @@ template<typename T>
 void insert_many_fast( sqlite::database&     db,
                        std::vector<T> const& in,
                        std::string const&    query ) {
-    auto f = L( "(" + impl::to_string( _ ) + ")" );
-    insert_many_fast( db, in, query, f );
+    auto f = []( util::FmtBuffer& buf, T const& e ){
+        buf += '(';
+        impl::format_to( buf, e );
+        buf += ')';
+    };
+
+    impl::insert_chunked( db, in, query, f );
 }
 
 } // namespace sqlite
@@ -0,0 +1,63 @@
+/****************************************************************
+* Unit tests for allocation tracking
+****************************************************************/
+#include "common-test.hpp"
+
+#include "alloc-tracker.hpp"
+#include "stopwatch.hpp"
+#include "string-util.hpp"
+
+#include <memory>
+
+using namespace std;
+
+namespace testing {
+
+TEST( alloc_tracking )
+{
+    util::AllocScope outer;
+    {
+        util::AllocScope inner;
+        auto p1 = make_unique<char[]>( 1000 );
+        {
+            auto p2 = make_unique<char[]>( 3000 );
+        }
+        auto v = make_unique<char[]>( 10 );
+        auto s = inner.stats();
+        if constexpr( util::alloc_tracking_enabled ) {
+            EQUALS( s.allocs, 3 );
+            EQUALS( s.frees, 1 );
+            TRUE_( s.bytes_allocated >= 4010 );
+            TRUE_( s.live() >= 1010 && s.live() < 1200 );
+            // Both p1 and p2 were live at once.
+            TRUE_( s.peak_live >= 4000 && s.peak_live < 4200 );
+            EQUALS( s.size_histogram[9],  1 ); // 1000
+            EQUALS( s.size_histogram[11], 1 ); // 3000
+            EQUALS( s.size_histogram[3],  1 ); // 10
+        } else {
+            EQUALS( s.allocs, 0 );
+            EQUALS( s.peak_live, 0 );
+        }
+    }
+    {
+        // A later, smaller peak doesn't hide the earlier one from
+        // the enclosing scope.
+        util::AllocScope inner;
+        auto p = make_unique<char[]>( 100 );
+    }
+    if constexpr( util::alloc_tracking_enabled ) {
+        EQUALS( outer.stats().allocs, 4 );
+        TRUE_( outer.stats().peak_live >= 4000 );
+    }
+
+    util::StopWatch watch;
+    watch.timeit( "strings", []{
+        auto s = make_unique<string>( 100, 'x' );
+    });
+    auto allocs = watch.allocs( "strings" );
+    TRUE_( bool( allocs ) == util::alloc_tracking_enabled );
+    if( allocs )
+        EQUALS( allocs->allocs, 2 );
+}
+
+} // namespace testing
@@ -0,0 +1,136 @@
+/****************************************************************
+* Unit tests for the benchmark harness
+****************************************************************/
+#include "common-test.hpp"
+
+#include "common-bench.hpp"
+#include "compare.hpp"
+#include "string-util.hpp"
+
+#include <cmath>
+
+using namespace std;
+
+namespace testing {
+
+TEST( bench_state )
+{
+    EQUALS( bench::median( {} ), 0 );
+    EQUALS( bench::median( { 3, 1, 2 } ), 2 );
+    // Even sizes take the mean of the two middle values.
+    EQUALS( bench::median( { 4, 1, 3, 2 } ), 2.5 );
+    EQUALS( bench::median( { 5, 5, 1, 9 } ), 5 );
+    // Deviations from 2.5 are 1.5, 0.5, 0.5, 1.5.
+    EQUALS( bench::mad( { 1, 2, 3, 4 } ), 1 );
+    EQUALS( bench::mad( { 7, 7, 7 } ), 0 );
+
+    // loop() calibrates, warms up, then takes the given number of
+    // samples, all with the calibrated batch size.
+    double const min_secs = 0.002;
+    bench::State state( 7, min_secs, 3 );
+    EQUALS( state.arg(), 7 );
+    uint64_t iters = 0, x = 0;
+    while( state.loop() ) {
+        ++iters;
+        bench::do_not_optimize( x += iters );
+    }
+    TRUE_( !state.loop() );
+    EQUALS( state.samples().size(), 3 );
+    auto batch = state.iters_per_sample();
+    TRUE_( batch > 1 );
+    // At least the warmup and the samples ran at the final size,
+    // after some smaller calibration batches.
+    TRUE_( iters > 4*batch );
+    for( double ns : state.samples() )
+        TRUE_( ns > 0 );
+    // Each sample took about the minimum time (the warmup would
+    // have restarted the calibration if far short of it).
+    TRUE_( bench::median( state.samples() )*double( batch ) >
+           0.25*min_secs*1e9 );
+}
+
+TEST( bench_compare )
+{
+    using bench::mann_whitney_p;
+
+    // Exact: of the 20 ways to order 3 a's and 3 b's, one has all
+    // a's first and one all b's first.
+    TRUE_( fabs( mann_whitney_p( { 1, 2, 3 }, { 4, 5, 6 } ) - 0.1 )
+           < 1e-12 );
+    TRUE_( fabs( mann_whitney_p( { 6, 4, 5 }, { 2, 3, 1 } ) - 0.1 )
+           < 1e-12 );
+    EQUALS( mann_whitney_p( { 1, 3, 5 }, { 2, 4, 6 } ), 0.7 );
+    EQUALS( mann_whitney_p( {}, { 1 } ), 1.0 );
+
+    // Ties: normal approximation with tie and continuity correc-
+    // tions; U = 2.5, variance = 20/12 * (10 - 30/72).
+    TRUE_( fabs( mann_whitney_p( { 1, 2, 2, 3 }, { 2, 3, 4, 5, 5 } )
+                 - 0.0785458509511907 ) < 1e-12 );
+    EQUALS( mann_whitney_p( { 4, 4, 4 }, { 4, 4 } ), 1.0 );
+
+    // Too many samples for the exact distribution.
+    vector<double> low, high, evens, odds;
+    for( int i = 0; i < 25; ++i ) {
+        low.push_back( i );      high.push_back( 25+i );
+        evens.push_back( 2*i );  odds.push_back( 2*i+1 );
+    }
+    TRUE_( fabs( mann_whitney_p( low, high )/1.4156562248495634e-09
+                 - 1 ) < 1e-6 );
+    TRUE_( fabs( mann_whitney_p( evens, odds ) - 0.8158901548607471 )
+           < 1e-12 );
+
+    // Results survive a round trip through a file.
+    auto make = []( string name, vector<double> samples ) {
+        bench::Result r{};
+        r.name    = move( name );
+        r.samples = move( samples );
+        r.median  = bench::median( r.samples );
+        r.mad     = bench::mad( r.samples );
+        return r;
+    };
+    vector<double> base;
+    for( int i = 0; i < 10; ++i ) base.push_back( 1000+i );
+    auto scaled = [&]( double f ) {
+        vector<double> res;
+        for( double x : base ) res.push_back( x*f );
+        return res;
+    };
+    vector<bench::Result> saved{
+        make( "slower",  base ),
+        make( "faster",  base ),
+        make( "same",    base ),
+        make( "small/3", base ),
+        make( "gone",    { 1.5, 2.25, 1e6 } ),
+    };
+    auto p = fs::temp_directory_path() / "cpp-test-bench.json";
+    bench::write_results( p.string(), saved );
+    auto loaded = bench::read_results( p.string() );
+    fs::remove( p );
+    EQUALS( loaded.size(), saved.size() );
+    for( size_t i = 0; i < saved.size(); ++i ) {
+        EQUALS( loaded[i].name,    saved[i].name    );
+        EQUALS( loaded[i].samples, saved[i].samples );
+        EQUALS( loaded[i].median,  saved[i].median  );
+    }
+
+    // Verdicts need both significance and a large enough change.
+    vector<bench::Result> current{
+        make( "slower",  scaled( 1.5 ) ),
+        make( "faster",  scaled( 0.5 ) ),
+        make( "same",    base ),
+        // Significant, but below the 5% threshold.
+        make( "small/3", scaled( 1.03 ) ),
+        make( "added",   base ),
+    };
+    auto comps = bench::compare( loaded, current, {} );
+    EQUALS( comps.size(), 5 );
+    TRUE_( comps[0].verdict == bench::Verdict::slower );
+    TRUE_( fabs( comps[0].change - 50 ) < 1e-9 );
+    TRUE_( comps[1].verdict == bench::Verdict::faster );
+    TRUE_( comps[2].verdict == bench::Verdict::same );
+    TRUE_( comps[3].verdict == bench::Verdict::same );
+    TRUE_( comps[3].p_value < 0.05 );
+    TRUE_( comps[4].verdict == bench::Verdict::added );
+}
+
+} // namespace testing
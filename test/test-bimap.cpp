@@ -0,0 +1,202 @@
+/****************************************************************
+* Unit tests for bi-directional maps
+****************************************************************/
+#include "common-test.hpp"
+
+#include "bimap.hpp"
+#include "string-util.hpp"
+
+#include <map>
+
+using namespace std;
+
+namespace testing {
+
+TEST( bimap_hashed )
+{
+    util::BiMapHashed<string, int> bm{
+        { "one", 1 }, { "three", 3 }, { "two", 2 } };
+
+    EQUALS( bm.size(), 3 );
+    EQUALS( bm.val( "two" ), 2 );
+    EQUALS( bm.key( 3 ), "three" );
+    TRUE_( !bm.val_safe( "four" ) );
+    TRUE_( !bm.key_safe( 4 ) );
+    THROWS( bm.val( "four" ) );
+    // Iterates in key order like BiMapFixed.
+    EQUALS( get<0>( *bm.begin() ), "one" );
+
+    // Larger map with keys that collide in the low bits.
+    vector<tuple<int, int>> data;
+    for( int i = 0; i < 10000; ++i )
+        data.emplace_back( i*1024, -i );
+    util::BiMapHashed<int, int> big( move( data ), true );
+    util::BiMapFixed<int, int>  ref{ { 5*1024, -5 } };
+    for( int i = 0; i < 10000; ++i ) {
+        EQUALS( big.val( i*1024 ), -i );
+        EQUALS( big.key( -i ), i*1024 );
+    }
+    TRUE_( !big.val_safe( 1 ) );
+    EQUALS( big.val( 5*1024 ), ref.val( 5*1024 ) );
+
+    util::BiMapHashed<int, int> empty( {} );
+    TRUE_( !empty.val_safe( 0 ) );
+}
+
+TEST( bdindexmap_eytzinger )
+{
+    // Every size up to a few full tree levels, to cover all the
+    // partially filled bottom rows.
+    for( int n = 0; n < 70; ++n ) {
+        vector<int> v;
+        for( int i = 0; i < n; ++i ) v.push_back( 3*i );
+        util::BDIndexMap<int> bm( move( v ), true,
+                                  util::SearchLayout::eytzinger );
+        EQUALS( bm.size(), size_t( n ) );
+        for( int i = -1; i < 3*n+1; ++i ) {
+            auto k = bm.key_safe( i );
+            if( i >= 0 && i < 3*n && i % 3 == 0 ) {
+                TRUE_( k );
+                EQUALS( *k, size_t( i/3 ) );
+                EQUALS( bm.val( *k ), i );
+            } else
+                TRUE_( !k );
+        }
+    }
+
+    util::BDIndexMap<string> names(
+        { "d", "b", "a", "c", "b" }, false,
+        util::SearchLayout::eytzinger );
+    EQUALS( names.size(), 4 );
+    EQUALS( names.key( "c" ), 2 );
+    THROWS( names.key( "e" ) );
+}
+
+TEST( batch_lookup )
+{
+    vector<int> v;
+    for( int i = 0; i < 1000; ++i ) v.push_back( 2*i );
+    util::BDIndexMap<int> bm( move( v ), true );
+
+    // Sorted queries (merge), including ones off either end.
+    vector<int> sorted_qs{ -5, 0, 1, 2, 2, 998, 1500, 1998, 5000 };
+    auto ks = bm.keys_of_safe( sorted_qs );
+    EQUALS( ks.size(), sorted_qs.size() );
+    for( size_t i = 0; i < ks.size(); ++i )
+        TRUE_( ks[i] == bm.key_safe( sorted_qs[i] ) );
+
+    // Unsorted queries (interleaved binary searches).
+    vector<int> qs;
+    for( int i = 0; i < 100; ++i ) qs.push_back( (i*337) % 2003 );
+    ks = bm.keys_of_safe( qs );
+    for( size_t i = 0; i < ks.size(); ++i )
+        TRUE_( ks[i] == bm.key_safe( qs[i] ) );
+
+    EQUALS( bm.keys_of( { 6, 2, 4 } ), (vector<size_t>{ 3, 1, 2 }) );
+    THROWS( bm.keys_of( { 6, 3 } ) );
+    EQUALS( bm.vals_of( { 3, 1 } ), (vector<int>{ 6, 2 }) );
+
+    util::BiMapFixed<string, int> bmf{
+        { "one", 1 }, { "three", 3 }, { "two", 2 } };
+    EQUALS( bmf.vals_of( { "two", "one" } ), (vector<int>{ 2, 1 }) );
+    EQUALS( bmf.keys_of( { 3, 1, 2 } ),
+            (vector<string>{ "three", "one", "two" }) );
+    auto vs = bmf.vals_of_safe( { "four", "three" } );
+    TRUE_( !vs[0] );
+    EQUALS( *vs[1], 3 );
+}
+
+TEST( bimap_mutable )
+{
+    util::BiMap<string, int> bm;
+    TRUE_( bm.empty() );
+
+    auto h1 = bm.insert( "one", 1 );
+    auto h2 = bm.insert( "two", 2 );
+    TRUE_( h1 && h2 );
+    // Neither duplicate keys nor duplicate values are allowed.
+    TRUE_( !bm.insert( "one", 3 ) );
+    TRUE_( !bm.insert( "three", 2 ) );
+    EQUALS( bm.size(), 2 );
+    EQUALS( bm.val( "two" ), 2 );
+    EQUALS( bm.key( 1 ), "one" );
+    EQUALS( get<0>( bm.get( *h2 ) ), "two" );
+    TRUE_( bm.find_val( 2 ) == h2 );
+
+    TRUE_( bm.erase_val( 2 ) );
+    TRUE_( !bm.erase_key( "two" ) );
+    TRUE_( !bm.val_safe( "two" ) );
+    THROWS( bm.key( 2 ) );
+    bm.erase( *h1 );
+    TRUE_( bm.empty() );
+
+    // Many inserts and erases with keys that share low bits, chec-
+    // king against std::map.
+    bm.reserve( 1000 );
+    map<string, int> ref_map;
+    for( int i = 0; i < 20000; ++i ) {
+        int  v = (i * 7919) % 4096 * 1024;
+        auto k = to_string( v );
+        if( ref_map.count( k ) ) {
+            TRUE_( bm.erase_key( k ) );
+            ref_map.erase( k );
+        } else {
+            TRUE_( bm.insert( k, v ) );
+            ref_map[k] = v;
+        }
+    }
+    EQUALS( bm.size(), ref_map.size() );
+    for( auto const& [k, v] : ref_map ) {
+        EQUALS( bm.val( k ), v );
+        EQUALS( bm.key( v ), k );
+    }
+    size_t count = 0;
+    bm.for_each( [&]( string const& k, int v ) {
+        ++count;
+        EQUALS( ref_map[k], v );
+    });
+    EQUALS( count, ref_map.size() );
+
+    // References stay valid across growth.
+    util::BiMap<int, int> ints;
+    ints.insert( 0, 100 );
+    int const& r0 = ints.val( 0 );
+    for( int i = 1; i < 5000; ++i ) ints.insert( i, 100+i );
+    EQUALS( r0, 100 );
+    EQUALS( &r0, &ints.val( 0 ) );
+}
+
+enum class color { red, green, blue };
+
+constexpr util::StaticBiMap<color, 3> colors{ {
+    { "red",   color::red   },
+    { "green", color::green },
+    { "blue",  color::blue  }
+} };
+
+// Lookups can be done at compile time.
+static_assert( colors.val_safe( "green" ) == color::green );
+static_assert( colors.key_safe( color::blue ) == "blue" );
+static_assert( !colors.val_safe( "yellow" ) );
+
+TEST( static_bimap )
+{
+    EQUALS( colors.size(), 3 );
+    EQUALS( colors.key( color::red ), "red" );
+    TRUE_( colors.val( "blue" ) == color::blue );
+    THROWS( colors.val( "purple" ) );
+    // Iterates in key order.
+    EQUALS( colors.begin()->key, "blue" );
+
+    // Non-dense values.
+    util::StaticBiMap<int, 3> sparse{ {
+        { "x", 100 }, { "y", -7 }, { "z", 42 } } };
+    EQUALS( sparse.key( -7 ), "y" );
+    EQUALS( sparse.val( "z" ), 42 );
+    TRUE_( !sparse.key_safe( 0 ) );
+
+    THROWS( (util::StaticBiMap<int, 2>{ { { "a", 1 },
+                                           { "a", 2 } } }) );
+}
+
+} // namespace testing
@@ -0,0 +1,355 @@
+/****************************************************************
+* Unit tests for graphs
+****************************************************************/
+#include "common-test.hpp"
+
+#include "graph-io.hpp"
+#include "graph.hpp"
+#include "mutable-graph.hpp"
+#include "string-util.hpp"
+
+#include <map>
+
+using namespace std;
+
+namespace testing {
+
+// Sorts since the order of accessible() results is unspecified.
+template<typename T>
+vector<T> sorted( vector<T> v ) {
+    sort( v.begin(), v.end() );
+    return v;
+}
+
+TEST( graph )
+{
+    map<string, vector<string>> m{
+        { "a", { "b", "c" } },
+        { "b", { "c", "d" } },
+        { "c", { "a"      } },
+        { "d", {          } },
+        { "e", { "d"      } }
+    };
+
+    auto g = util::make_graph( m );
+    EQUALS( g.size(), 5 );
+    EQUALS( g.csr().num_edges(), 6 );
+
+    EQUALS( sorted( g.accessible( "a" ) ),
+            (vector<string>{ "a", "b", "c", "d" }) );
+    EQUALS( sorted( g.accessible( "c", false ) ),
+            (vector<string>{ "a", "b", "d" }) );
+    EQUALS( g.accessible( "d", false ), vector<string>{} );
+    EQUALS( sorted( g.accessible( "e" ) ),
+            (vector<string>{ "d", "e" }) );
+    EQUALS( g.accessible( "x" ), vector<string>{} );
+
+    // Reusing a workspace must give the same results.
+    util::GraphWorkspace ws;
+    for( int i = 0; i < 3; ++i )
+        EQUALS( sorted( g.accessible( "b", true, ws ) ),
+                (vector<string>{ "a", "b", "c", "d" }) );
+
+    util::CsrGraph csr( vector<vector<uint32_t>>{
+        { 1, 2 }, { 2 }, {} } );
+    auto rev = csr.reversed();
+    EQUALS( rev.num_nodes(), 3 );
+    EQUALS( rev.offsets(), (vector<uint32_t>{ 0, 0, 1, 3 }) );
+    EQUALS( rev.targets(), (vector<uint32_t>{ 0, 0, 1 }) );
+
+    THROWS( util::CsrGraph( { 0, 1 }, { 1 } ) );
+    THROWS( util::CsrGraph( { 0, 2 }, { 0 } ) );
+}
+
+TEST( graph_par )
+{
+    // A graph with a hub and otherwise random edges, so that the
+    // search quickly reaches most of the graph and switches to the
+    // bottom-up direction. The nodes above 9000 are unreachable.
+    uint32_t const n = 10000;
+    vector<vector<uint32_t>> adj( n );
+    for( uint32_t i = 1; i < 500; ++i )
+        adj[0].push_back( i );
+    uint64_t r = 12345;
+    for( uint32_t i = 1; i < 9000; ++i ) {
+        for( int k = 0; k < 3; ++k ) {
+            r = r*6364136223846793005ull + 1442695040888963407ull;
+            adj[i].push_back( uint32_t( (r >> 33) % 9000 ) );
+        }
+    }
+    adj[9500].push_back( 0 );
+    util::CsrGraph g( adj );
+    util::CsrGraph rev = g.reversed();
+
+    util::GraphWorkspace ws;
+    for( uint32_t start : { 0u, 7u, 9500u, 9999u } ) {
+        util::csr_reachable( g.view(), start, ws );
+        auto expected = sorted( ws.result );
+        for( int jobs : { 1, 2, 4 } ) {
+            vector<uint32_t> ids;
+            util::csr_reachable_par( g.view(),
+                [&]{ return rev.view(); }, start, jobs, ids, 0 );
+            EQUALS( sorted( ids ), expected );
+        }
+    }
+
+    // Small graphs take the serial path.
+    map<string, vector<string>> m{
+        { "a", { "b" } }, { "b", { "a" } }, { "c", {} } };
+    auto dg = util::make_graph( m );
+    EQUALS( sorted( dg.accessible_par( "a", 4 ) ),
+            (vector<string>{ "a", "b" }) );
+    EQUALS( dg.accessible_par( "b", 4, false ),
+            vector<string>{ "a" } );
+}
+
+TEST( graph_closure )
+{
+    // Random sparse graph with plenty of cycles and some isolated
+    // nodes, with string names.
+    int const n = 300;
+    map<string, vector<string>> m;
+    uint64_t r = 777;
+    for( int i = 0; i < n; ++i ) {
+        auto& es = m[to_string( i )];
+        for( int k = 0; k < i % 3; ++k ) {
+            r = r*6364136223846793005ull + 1442695040888963407ull;
+            es.push_back( to_string( (r >> 33) % n ) );
+        }
+    }
+    auto g = util::make_graph( m );
+
+    vector<string> names;
+    for( int i = 0; i < n; ++i ) names.push_back( to_string( i ) );
+    names.push_back( "missing" );
+
+    auto many = g.accessible_many( names, false );
+    EQUALS( many.size(), names.size() );
+    for( size_t i = 0; i < names.size(); ++i )
+        EQUALS( sorted( many[i] ),
+                sorted( g.accessible( names[i], false ) ) );
+
+    TRUE_( !g.has_closure() );
+    vector<vector<bool>> expected( n, vector<bool>( n ) );
+    for( int a = 0; a < n; ++a ) {
+        for( auto const& b : g.accessible( to_string( a ) ) )
+            expected[a][stoi( b )] = true;
+        TRUE_( g.reachable( to_string( a ), to_string( a ) ) );
+    }
+    g.build_closure();
+    TRUE_( g.has_closure() );
+    for( int a = 0; a < n; ++a )
+        for( int b = 0; b < n; ++b )
+            EQUALS( g.reachable( to_string( a ), to_string( b ) ),
+                    bool( expected[a][b] ) );
+    TRUE_( !g.reachable( "0", "missing" ) );
+    g.drop_closure();
+    TRUE_( !g.has_closure() );
+}
+
+TEST( graph_structure )
+{
+    map<string, vector<string>> m{
+        { "a", { "b"      } },
+        { "b", { "c"      } },
+        { "c", { "a", "d" } },
+        { "d", { "e"      } },
+        { "e", {          } },
+        { "f", {          } }
+    };
+    auto g = util::make_graph( m );
+
+    auto comps = g.sccs();
+    for( auto& c : comps ) c = sorted( c );
+    EQUALS( sorted( comps ), (vector<vector<string>>{
+        { "a", "b", "c" }, { "d" }, { "e" }, { "f" } }) );
+
+    auto cond = g.condensation();
+    EQUALS( cond.components.size(), 4 );
+    EQUALS( cond.dag.num_edges(), 2 );
+
+    TRUE_( !g.topo_sort() );
+    EQUALS( g.levels().size(), 3 );
+    EQUALS( sorted( g.levels()[0] ),
+            (vector<string>{ "a", "b", "c", "f" }) );
+    EQUALS( g.levels()[2], vector<string>{ "e" } );
+
+    m["c"] = { "d" };
+    auto dag = util::make_graph( m );
+    auto order = dag.topo_sort();
+    TRUE_( order );
+    EQUALS( order->size(), 6 );
+    auto pos = [&]( string const& s ) {
+        return find( order->begin(), order->end(), s ) -
+               order->begin();
+    };
+    for( auto const& [from, tos] : m )
+        for( auto const& to : tos )
+            TRUE_( pos( from ) < pos( to ) );
+    EQUALS( dag.levels().size(), 5 );
+
+    // A long chain with a back edge must not overflow the stack.
+    uint32_t const n = 1000000;
+    vector<uint32_t> offsets, targets;
+    for( uint32_t i = 0; i < n; ++i ) {
+        offsets.push_back( i );
+        targets.push_back( (i+1) % n );
+    }
+    offsets.push_back( n );
+    util::CsrGraph chain( move( offsets ), move( targets ) );
+    EQUALS( util::csr_sccs( chain.view() ).count, 1 );
+    TRUE_( !util::csr_topo_sort( chain.view() ) );
+}
+
+TEST( graph_reverse )
+{
+    // a -> b -> c -> d, and e -> c.
+    map<string, vector<string>> m{
+        { "a", { "b" } },
+        { "b", { "c" } },
+        { "c", { "d" } },
+        { "d", {     } },
+        { "e", { "c" } }
+    };
+    auto g = util::make_graph( m, util::ReverseIndexMode::eager );
+
+    EQUALS( sorted( g.reverse_accessible( "c" ) ),
+            (vector<string>{ "a", "b", "c", "e" }) );
+    EQUALS( g.reverse_accessible( "a", false ), vector<string>{} );
+    EQUALS( g.reverse_accessible( "x" ), vector<string>{} );
+
+    util::SearchLimits depth1;
+    depth1.max_depth = 1;
+    EQUALS( g.accessible_bounded( "a", depth1 ),
+            (vector<string>{ "a", "b" }) );
+    EQUALS( sorted( g.reverse_accessible_bounded( "c", depth1,
+                                                  false ) ),
+            (vector<string>{ "b", "e" }) );
+
+    util::SearchLimits count2;
+    count2.max_count = 2;
+    EQUALS( g.accessible_bounded( "a", count2, false ),
+            (vector<string>{ "b", "c" }) );
+    EQUALS( g.accessible_bounded( "a", count2 ).size(), 2 );
+    // Results come in order of distance.
+    EQUALS( g.accessible_bounded( "a", {} ),
+            (vector<string>{ "a", "b", "c", "d" }) );
+}
+
+TEST( graph_io )
+{
+    map<string, vector<string>> m{
+        { "a",   { "bb", "c" } },
+        { "bb",  { "c", "d"  } },
+        { "c",   { "a"       } },
+        { "d",   {           } },
+        { "eee", { "d"       } }
+    };
+    auto g = util::make_graph( m );
+
+    auto p = fs::temp_directory_path() / "cpp-test-graph-io.bin";
+    util::write_graph( p, g );
+
+    util::MappedGraph mg( p, true );
+    EQUALS( mg.size(), g.size() );
+    EQUALS( mg.view().num_edges(), g.csr().num_edges() );
+    EQUALS( mg.name( 4 ), "eee" );
+    TRUE_( mg.id( "bb" ) == 1u );
+    TRUE_( !mg.id( "b" ) );
+    for( auto const& [k, _] : m ) {
+        vector<string> v;
+        for( auto sv : mg.accessible( k, false ) )
+            v.emplace_back( sv );
+        EQUALS( sorted( v ), sorted( g.accessible( k, false ) ) );
+    }
+    TRUE_( mg.accessible( "x" ).empty() );
+
+    // The loaded graph can be used with the CSR algorithms.
+    EQUALS( util::csr_sccs( mg.view() ).count, 3 );
+
+    // Corrupt a name; only detected with verify.
+    auto bytes = util::read_file( p );
+    bytes[bytes.size()-1] ^= 1;
+    util::write_file( p, bytes );
+    util::MappedGraph unverified( p, false );
+    EQUALS( unverified.name( 4 ), "eed" );
+    THROWS( util::MappedGraph( p, true ) );
+
+    util::write_file( p, { 'x', 'y' } );
+    THROWS( util::MappedGraph{ p } );
+
+    util::write_graph( p, util::CsrView{}, {} );
+    EQUALS( util::MappedGraph( p, true ).size(), 0 );
+    fs::remove( p );
+}
+
+TEST( mutable_graph )
+{
+    util::MutableGraph<string> g;
+    TRUE_( g.add_edge( "a", "b" ) );
+    TRUE_( !g.add_edge( "a", "b" ) );
+    TRUE_( g.add_edge( "b", "c" ) );
+    TRUE_( !g.add_node( "c" ) );
+    TRUE_( g.add_node( "d" ) );
+    EQUALS( g.size(), 4 );
+    EQUALS( g.num_edges(), 2 );
+    EQUALS( sorted( g.accessible( "a" ) ),
+            (vector<string>{ "a", "b", "c" }) );
+
+    // The cached set for "a" is extended by new edges.
+    g.add_edge( "c", "d" );
+    TRUE_( g.reachable( "a", "d" ) );
+    // ...and dropped when edges are removed.
+    TRUE_( g.remove_edge( "b", "c" ) );
+    TRUE_( !g.remove_edge( "b", "c" ) );
+    EQUALS( sorted( g.accessible( "a", false ) ),
+            vector<string>{ "b" } );
+
+    // Adding "c" -> "a" violates the current order, but there is
+    // no cycle since "b" -> "c" is gone.
+    g.add_edge( "c", "a" );
+    auto order = g.topo_sort();
+    TRUE_( order );
+    EQUALS( *order, (vector<string>{ "c", "a", "b", "d" }) );
+    g.add_edge( "b", "c" );
+    TRUE_( !g.topo_sort() );
+    TRUE_( g.remove_node( "a" ) );
+    TRUE_( !g.contains( "a" ) );
+    EQUALS( g.num_edges(), 2 );
+    TRUE_( g.topo_sort() );
+
+    // Random changes, checked against a snapshot after each one.
+    util::MutableGraph<int> rg;
+    uint64_t r = 99;
+    auto rnd = [&]( int n ) {
+        r = r*6364136223846793005ull + 1442695040888963407ull;
+        return int( (r >> 33) % n );
+    };
+    for( int step = 0; step < 600; ++step ) {
+        int a = rnd( 40 ), b = rnd( 40 );
+        switch( rnd( 8 ) ) {
+            case 0:  rg.remove_node( a );    break;
+            case 1:
+            case 2:  rg.remove_edge( a, b ); break;
+            default: rg.add_edge( a, b );    break;
+        }
+        int probe = rnd( 40 );
+        auto snap = rg.snapshot();
+        EQUALS( snap.size(), rg.size() );
+        EQUALS( snap.csr().num_edges(), rg.num_edges() );
+        EQUALS( sorted( rg.accessible( probe ) ),
+                sorted( snap.accessible( probe ) ) );
+        auto o = rg.topo_sort();
+        EQUALS( bool( o ), bool( snap.topo_sort() ) );
+        if( o ) {
+            map<int, size_t> pos;
+            for( size_t i = 0; i < o->size(); ++i )
+                pos[(*o)[i]] = i;
+            for( int x : *o )
+                for( int y : snap.accessible( x, false ) )
+                    TRUE_( pos[x] < pos[y] );
+        }
+    }
+}
+
+} // namespace testing
@@ -0,0 +1,57 @@
+/****************************************************************
+* Unit tests for string interning
+****************************************************************/
+#include "common-test.hpp"
+
+#include "algo-par.hpp"
+#include "bimap.hpp"
+#include "interner.hpp"
+#include "string-util.hpp"
+
+#include <numeric>
+
+using namespace std;
+
+namespace testing {
+
+TEST( interner )
+{
+    util::Interner in;
+
+    auto a1 = in.intern( "a/b/c" );
+    auto a2 = in.intern( "a/b/d" );
+    auto a3 = in.intern( string( "a/b/c" ) );
+
+    TRUE_( a1 == a3 );
+    TRUE_( a1 != a2 );
+    EQUALS( in.size(), 2 );
+    EQUALS( in.str( a1 ), "a/b/c" );
+    EQUALS( in.str( a2 ), "a/b/d" );
+    TRUE_( in.find( "a/b/d" ) == a2 );
+    TRUE_( !in.find( "a/b/e" ) );
+    EQUALS( in.size(), 2 );
+    TRUE_( !util::Atom().valid() );
+    THROWS( in.str( util::Atom() ) );
+
+    // Intern the same strings from many threads at once and make
+    // sure they all agree on the atoms.
+    vector<int> jobs( 8 );
+    iota( jobs.begin(), jobs.end(), 0 );
+    auto atoms = util::par::map( [&in]( int ){
+        vector<util::Atom> res;
+        for( int i = 0; i < 1000; ++i )
+            res.push_back( in.intern( "path/" + to_string( i ) ) );
+        return res;
+    }, jobs, 8 );
+    for( auto const& v : atoms )
+        TRUE_( v == atoms[0] );
+    EQUALS( in.size(), 1002 );
+    EQUALS( in.str( atoms[3][567] ), "path/567" );
+
+    // Atoms can be used as keys in the bimaps.
+    util::BDIndexMap<util::Atom> bm( vector{ a2, a1, a2 } );
+    EQUALS( bm.size(), 2 );
+    TRUE_( bm.key_safe( a1 ) );
+}
+
+} // namespace testing
@@ -0,0 +1,88 @@
+/****************************************************************
+* Unit tests for latency histograms
+****************************************************************/
+#include "common-test.hpp"
+
+#include "io.hpp"
+#include "latency.hpp"
+#include "string-util.hpp"
+
+#include <sstream>
+
+using namespace std;
+
+namespace testing {
+
+fs::path const data_local = "../test/data-local";
+
+TEST( latency_histogram )
+{
+    util::LatencyHistogram h;
+    EQUALS( h.summary().count, 0 );
+    EQUALS( h.percentile( 0.5 ), 0 );
+
+    // 1..10000 ns, once each.
+    for( uint64_t i = 1; i <= 10000; ++i )
+        h.record( i );
+    auto s = h.summary();
+    EQUALS( s.count, 10000 );
+    EQUALS( s.max, 10000 );
+    TRUE_( s.mean > 5000.0 && s.mean < 5001.0 );
+    // Exact below 32, then within the ~3% bucket width.
+    auto near = []( uint64_t v, uint64_t want ){
+        return v >= want && v <= want + want/32;
+    };
+    TRUE_( near( s.p50,  5000 ) );
+    TRUE_( near( s.p90,  9000 ) );
+    TRUE_( near( s.p99,  9900 ) );
+    TRUE_( near( s.p999, 9990 ) );
+    EQUALS( h.percentile( 0.0005 ), 5 );
+    EQUALS( h.percentile( 1.0 ), 10000 );
+
+    // Extremes of the range land in valid buckets.
+    util::LatencyHistogram big;
+    big.record( 0 );
+    big.record( uint64_t( -1 ) );
+    EQUALS( big.percentile( 1.0 ), uint64_t( -1 ) );
+    EQUALS( big.percentile( 0.5 ), 0 );
+
+    h.merge( big );
+    EQUALS( h.count(), 10002 );
+    EQUALS( h.summary().max, uint64_t( -1 ) );
+    h.reset();
+    EQUALS( h.count(), 0 );
+
+    ostringstream out;
+    util::LatencyHistogram small;
+    small.record( 1500 );
+    out << small.summary();
+    EQUALS( out.str(), "n=1 mean=1.5us p50=1.5us p90=1.5us "
+                       "p99=1.5us p99.9=1.5us max=1.5us" );
+
+    // Values that round up to 1000 move to the next unit.
+    auto mean_str = []( vector<uint64_t> const& v ) {
+        util::LatencyHistogram lh;
+        for( auto ns : v ) lh.record( ns );
+        ostringstream o;
+        o << lh.summary();
+        auto str = o.str();
+        return string( util::split( str, ' ' )[1] );
+    };
+    EQUALS( mean_str( { 999, 1000 } ),      "mean=1us"     );
+    EQUALS( mean_str( { 999999 } ),         "mean=1ms"     );
+    EQUALS( mean_str( { 12345000000000 } ), "mean=12345s" );
+
+    // Registered histograms are shared by name, and read_file is
+    // instrumented.
+    auto& rf = util::latency_histogram( "util::read_file" );
+    TRUE_( &rf == &util::latency_histogram( "util::read_file" ) );
+    auto before = rf.count();
+    util::read_file( data_local / "preprocessor-input.txt" );
+    EQUALS( rf.count(), before+1 );
+    bool found = false;
+    for( auto const& [name, summary] : util::latency_report() )
+        found |= (name == "util::read_file" && summary.count > 0);
+    TRUE_( found );
+}
+
+} // namespace testing
@@ -0,0 +1,63 @@
+/****************************************************************
+* Unit tests for logging
+****************************************************************/
+#include "common-test.hpp"
+
+#include "algo-par.hpp"
+#include "logger.hpp"
+#include "string-util.hpp"
+
+#include <map>
+#include <sstream>
+
+using namespace std;
+
+namespace testing {
+
+TEST( logger )
+{
+    // Capture what the writer thread sends to cout.
+    ostringstream captured;
+    auto* old_buf = cout.rdbuf( captured.rdbuf() );
+    util::Logger::enabled = true;
+
+    util::log << "partial";
+    util::log.flush();
+    EQUALS( captured.str(), "partial" );
+    captured.str( "" );
+
+    // Lines from different threads are not interleaved.
+    util::par::for_each( vector<int>( 8, 0 ), []( int ){
+        for( int i = 0; i < 100; ++i )
+            util::log << "line " << i << " of " << 100 << "\n";
+    }, 8 );
+    util::log.flush();
+    map<string, int> counts;
+    auto out = captured.str();
+    for( auto const& line : util::split( out, '\n' ) )
+        if( !line.empty() )
+            ++counts[string( line )];
+    EQUALS( counts.size(), 100 );
+    for( auto const& [line, count] : counts ) {
+        TRUE_( util::starts_with( line, "line " ) );
+        EQUALS( count, 8 );
+    }
+    captured.str( "" );
+
+    util::Logger::level = util::LogLevel::info;
+    int evaluated = 0;
+    LOG_DEBUG << "not shown " << ++evaluated << "\n";
+    LOG_INFO  << "shown " << ++evaluated << "\n";
+    LOG_ERROR << "shown " << ++evaluated << "\n";
+    util::Logger::level = util::LogLevel::debug;
+    util::Logger::enabled = false;
+    LOG_ERROR << "not shown " << ++evaluated << "\n";
+    util::log << "not shown\n";
+    util::log.flush();
+
+    cout.rdbuf( old_buf );
+    EQUALS( evaluated, 2 );
+    EQUALS( captured.str(), "[info] shown 1\n[error] shown 2\n" );
+}
+
+} // namespace testing
@@ -0,0 +1,61 @@
+/****************************************************************
+* Unit tests for multi-pattern substring search
+****************************************************************/
+#include "common-test.hpp"
+
+#include "multi-match.hpp"
+#include "opt-util.hpp"
+#include "string-util.hpp"
+
+using namespace std;
+
+namespace testing {
+
+TEST( multi_match )
+{
+    using M = util::MultiMatcher::Match;
+
+    util::MultiMatcher mm( { "he", "she", "his", "hers", "he" } );
+    EQUALS( mm.size(), 5 );
+
+    TRUE_(  mm.any_of( "ushers" ) );
+    TRUE_( !mm.any_of( "xyz" ) );
+    TRUE_( !mm.any_of( "" ) );
+
+    auto first = mm.first_match( "ushers" );
+    TRUE_( first );
+    // "she" and "he" both end at position 3; the longer wins.
+    TRUE_( *first == (M{ 1, 1 }) );
+
+    auto all = mm.all_matches( "ushers" );
+    EQUALS( all.size(), 4 );
+    TRUE_( all[0] == (M{ 1, 1 }) );
+    // The duplicate patterns are both reported.
+    TRUE_( (all[1] == M{ 4, 2 } && all[2] == M{ 0, 2 }) ||
+           (all[1] == M{ 0, 2 } && all[2] == M{ 4, 2 }) );
+    TRUE_( all[3] == (M{ 3, 2 }) );
+
+    // Must agree with util::contains for every pattern.
+    vector<string> pats{ "error", "warn", "fatal", "rror:" };
+    util::MultiMatcher logs( pats );
+    string text = "info: ok\r\nwarning: x\nnothing\nerror: y\n"
+                  "fatal\n";
+    EQUALS( logs.matching_lines( text ),
+            (vector<size_t>{ 1, 3, 4 }) );
+    for( auto line : util::split( text, '\n' ) ) {
+        bool any = false;
+        for( auto const& p : pats )
+            any = any || util::contains( line, p );
+        EQUALS( logs.any_of( line ), any );
+    }
+
+    // Single distinct first byte uses the memchr prefilter.
+    util::MultiMatcher slashes( { "/usr", "/opt/x" } );
+    auto m = slashes.first_match( "a/b/c/opt/x/usr" );
+    TRUE_( m );
+    TRUE_( *m == (M{ 1, 5 }) );
+
+    THROWS( util::MultiMatcher( { "a", "" } ) );
+}
+
+} // namespace testing
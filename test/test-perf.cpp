@@ -0,0 +1,52 @@
+/****************************************************************
+* Unit tests for hardware performance counters
+****************************************************************/
+#include "common-test.hpp"
+
+#include "perf-counters.hpp"
+#include "stopwatch.hpp"
+#include "string-util.hpp"
+
+#include <sstream>
+
+using namespace std;
+
+namespace testing {
+
+TEST( perf_counters )
+{
+    util::PerfSample s;
+    s.values[size_t( util::PerfEvent::cycles )]        = 1000;
+    s.values[size_t( util::PerfEvent::instructions )]  = 2000;
+    s.values[size_t( util::PerfEvent::branch_misses )] = 3;
+    TRUE_( s.ipc() == 2.0 );
+    TRUE_( s.mpki( util::PerfEvent::branch_misses ) == 1.5 );
+    TRUE_( !s.mpki( util::PerfEvent::llc_misses ) );
+    ostringstream out;
+    out << s;
+    EQUALS( out.str(), "cycles=1000 instructions=2000 "
+                       "branch-misses=3 IPC=2.00 "
+                       "branch-misses/KI=1.50" );
+    auto d = s - s;
+    TRUE_( d[util::PerfEvent::cycles] == 0u );
+    TRUE_( !d[util::PerfEvent::l1d_misses] );
+
+    // The kernel may not allow access to the counters here, in
+    // which case everything should still work but with no counts.
+    util::StopWatch watch;
+    bool available = watch.enable_perf_counters();
+    volatile uint64_t sum = 0;
+    watch.timeit( "loop", [&]{
+        for( int i = 0; i < 100000; ++i ) sum = sum + i;
+    });
+    auto perf = watch.perf( "loop" );
+    TRUE_( available == bool( perf ) );
+    if( perf )
+        TRUE_( (*perf)[util::PerfEvent::instructions].value_or( 1 ) > 0 );
+
+    util::StopWatch plain;
+    plain.timeit( "x", []{} );
+    TRUE_( !plain.perf( "x" ) );
+}
+
+} // namespace testing
@@ -0,0 +1,147 @@
+/****************************************************************
+* Unit tests for string utilities
+****************************************************************/
+#include "common-test.hpp"
+
+#include "fs.hpp"
+#include "opt-util.hpp"
+#include "string-util.hpp"
+#include "types.hpp"
+
+#include <unordered_map>
+
+using namespace std;
+using namespace std::string_literals;
+
+namespace testing {
+
+TEST( to_string )
+{
+    EQUALS( util::to_string( 55 ), "55" );
+    EQUALS( util::to_string( -7L ), "-7" );
+    EQUALS( util::to_string( 'c' ), "'c'" );
+    EQUALS( util::to_string( "hello" ), "\"hello\"" );
+    EQUALS( util::to_string( "hello"s ), "\"hello\"" );
+    EQUALS( util::to_string( fs::path( "A/B" ) ), "\"A/B\"" );
+
+    optional<int> o1, o2{ 5 };
+    EQUALS( util::to_string( o1 ), "nullopt" );
+    EQUALS( util::to_string( o2 ), "5" );
+
+    EQUALS( util::to_string( vector<int>{} ), "[]" );
+    EQUALS( util::to_string( pair{ 1, "x"s } ), "(1,\"x\")" );
+
+    variant<int, string> v1{ 3 }, v2{ "three"s };
+    EQUALS( util::to_string( v1 ), "3" );
+    EQUALS( util::to_string( v2 ), "\"three\"" );
+
+    vector<tuple<int, string, optional<char>>> vt{
+        { 1, "one", 'a'     },
+        { 2, "two", nullopt },
+    };
+    EQUALS( util::to_string( vt ),
+            "[(1,\"one\",'a'),(2,\"two\",nullopt)]" );
+
+    // format_to should append to what is already in the buffer.
+    util::FmtBuffer buf = "x=";
+    util::format_to( buf, vector<int>{ 1, 2, 3 } );
+    util::format_to( buf, tuple<>{} );
+    EQUALS( buf, "x=[1,2,3]()" );
+
+    TRUE_( util::estimate_size( vt ) >= util::to_string( vt ).size() );
+}
+
+TEST( parse )
+{
+    EQUALS( util::parse<int>( "123" ), 123 );
+    EQUALS( util::parse<int>( "-45" ), -45 );
+    EQUALS( util::parse<int>( "ff", 16 ), 255 );
+    EQUALS( util::parse<uint64_t>( "18446744073709551615" ),
+            numeric_limits<uint64_t>::max() );
+    EQUALS( util::parse<double>( "2.5" ), 2.5 );
+    EQUALS( util::parse<float>( "-0.25" ), -0.25f );
+
+    EQUALS( util::parse<int>( "" ),       nullopt );
+    EQUALS( util::parse<int>( " 1" ),     nullopt );
+    EQUALS( util::parse<int>( "1 " ),     nullopt );
+    EQUALS( util::parse<int>( "12a" ),    nullopt );
+    EQUALS( util::parse<uint8_t>( "256" ), nullopt );
+    EQUALS( util::parse<unsigned>( "-1" ), nullopt );
+    EQUALS( util::parse<double>( "1.5x" ), nullopt );
+    EQUALS( util::parse<double>( "+1.5" ), nullopt );
+
+    EQUALS( util::stoi( "77" ), 77 );
+    THROWS( util::stoi( "" ) );
+    THROWS( util::stoi( "7x" ) );
+}
+
+TEST( iequals )
+{
+    TRUE_(  util::iequals( "Hello World"s, "hELLO wORLD"s ) );
+    TRUE_( !util::iequals( "Hello World"s, "Hello-World"s ) );
+    TRUE_( !util::iequals( "abc"s, "abcd"s ) );
+    // Long enough to exercise the word-at-a-time path plus a tail.
+    TRUE_(  util::iequals( "ABCDEFGHIJKLMNOPQRSTUVWXYZ@[`{"s,
+                           "abcdefghijklmnopqrstuvwxyz@[`{"s ) );
+    // The characters just outside of the letter ranges  must  not
+    // be folded.
+    TRUE_( !util::ascii_iequals( "@@@@@@@@[", "````````{" ) );
+    // Non-ASCII bytes must match exactly.
+    TRUE_(  util::ascii_iequals( "Caf\xc3\xa9 au LAIT",
+                                 "cAF\xc3\xa9 AU lait" ) );
+    TRUE_( !util::ascii_iequals( "Caf\xc3\xa9 au LAIT",
+                                 "Caf\xc3\x89 au LAIT" ) );
+    TRUE_( util::iequals( wstring( L"AbC" ), wstring( L"aBc" ) ) );
+
+    EQUALS( util::ascii_ihash( "Some/Path/File.TXT" ),
+            util::ascii_ihash( "some/path/file.txt" ) );
+    TRUE_( util::ascii_ihash( "abc" ) != util::ascii_ihash( "abd" ) );
+
+    unordered_map<fs::path, int, util::ihash, util::iequal_to> m;
+    m[fs::path( "A/b/C.txt" )] = 5;
+    EQUALS( m.size(), 1 );
+    EQUALS( m.count( fs::path( "a/B/c.TXT" ) ), 1 );
+    EQUALS( m.count( fs::path( "a/B/d.TXT" ) ), 0 );
+
+    TRUE_( util::path_equals( "A//B/c", "a/b/C",
+                              util::CaseSensitive::NO ) );
+}
+
+TEST( wrap_text )
+{
+    string_view text = "  The quick\tbrown fox\n\njumps over the "
+                       "extraordinarily lazy dog.  ";
+
+    vector<string> expected{
+        "The quick",
+        "brown fox",
+        "jumps over",
+        "the",
+        "extraordinarily",
+        "lazy dog.",
+    };
+    EQUALS( util::wrap_text( text, 10 ), expected );
+
+    // The adapter for the predicate-based API must agree.
+    auto is_ok = []( string_view sv ){ return sv.size() <= 10; };
+    EQUALS( util::wrap_text_fn( text, is_ok ), expected );
+
+    EQUALS( util::wrap_text( "", 10 ), vector<string>{} );
+    EQUALS( util::wrap_text( " \n\t ", 10 ), vector<string>{} );
+
+    // Incremental width interface: here every char counts double
+    // and spaces count as three.
+    util::TextWrapper wrapper;
+    auto width = []( string_view word, bool first ) {
+        return int( word.size()*2 ) + (first ? 0 : 3);
+    };
+    auto const& lines = wrapper.wrap( "ab cd ef gh", 11, width );
+    EQUALS( lines.size(), 2 );
+    EQUALS( lines[0], "ab cd" );
+    EQUALS( lines[1], "ef gh" );
+
+    // The wrapper can be reused.
+    EQUALS( wrapper.wrap( "a b c", 3 ).size(), 2 );
+}
+
+} // namespace testing
@@ -0,0 +1,80 @@
+/****************************************************************
+* Unit tests for tracing
+****************************************************************/
+#include "common-test.hpp"
+
+#include "algo-par.hpp"
+#include "string-util.hpp"
+#include "trace.hpp"
+
+#include <sstream>
+
+using namespace std;
+
+namespace testing {
+
+TEST( trace )
+{
+    namespace tr = util::trace;
+
+    tr::drain();
+    {
+        tr::Scope s( "outer" );
+        tr::instant( "mark \"quoted\"" );
+    }
+    // Events recorded from several threads are all collected.
+    util::par::for_each( vector<int>( 4 ), []( int ){
+        tr::record( "worker", 1000, 3500 );
+    }, 4 );
+
+    // for_each itself records one event per job when enabled.
+#ifdef ENABLE_TRACING
+    size_t const job_events = 4;
+#else
+    size_t const job_events = 0;
+#endif
+    auto events = tr::drain();
+    EQUALS( events.size(), 6 + job_events );
+    // Sorted by start time.
+    EQUALS( string( events[0].name ), "worker" );
+    EQUALS( events[0].dur_ns, 2500 );
+    EQUALS( string( events[4].name ), "outer" );
+    TRUE_( events[5].instant );
+    TRUE_( events[5].start_ns >= events[4].start_ns );
+    TRUE_( tr::drain().empty() );
+
+    ostringstream out;
+    tr::write_chrome_json( out, { events[0], events[5] } );
+    auto json = out.str();
+    TRUE_( util::contains( json, "\"name\":\"worker\",\"ph\":\"X\","
+                                 "\"ts\":0.000,\"dur\":2.500" ) );
+    TRUE_( util::contains( json, "\"mark \\\"quoted\\\"\"" ) );
+    TRUE_( util::contains( json, "\"ph\":\"i\"" ) );
+
+    // A full ring drops events rather than blocking.
+    auto before = tr::dropped();
+    for( int i = 0; i < 20000; ++i )
+        tr::instant( "spam" );
+    EQUALS( tr::drain().size(), 1 << 14 );
+    EQUALS( tr::dropped() - before, 20000 - (1 << 14) );
+
+    // The rings of exited threads are freed once drained, so that
+    // repeated parallel calls don't accumulate them.
+    auto rings = tr::num_rings();
+    for( int i = 0; i < 10; ++i ) {
+        util::par::for_each( vector<int>( 4 ), []( int ){
+            tr::instant( "job" );
+        }, 4 );
+        TRUE_( tr::num_rings() > rings );
+        EQUALS( tr::drain().size(), 4 + job_events );
+        EQUALS( tr::num_rings(), rings );
+    }
+
+#ifndef ENABLE_TRACING
+    // The macros compile to nothing.
+    { TRACE_SCOPE( "nothing" ); TRACE_INSTANT( "nothing" ); }
+    TRUE_( tr::drain().empty() );
+#endif
+}
+
+} // namespace testing
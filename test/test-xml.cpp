@@ -3,6 +3,7 @@
 ****************************************************************/
 #include "common-test.hpp"
 
+#include "opt-util.hpp"
 #include "string-util.hpp"
 #include "xml-util.hpp"
 
@@ -31,6 +32,11 @@ TEST( xml_filter )
     TRUE_( a );
     EQUALS( *a, "jack" );
 
+    auto rev = xml::attribute<int>( v1[0], "revision" );
+    EQUALS( rev, 11 );
+    auto item = xml::attribute<int>( v1[0], "item" );
+    EQUALS( item, nullopt );
+
     auto f2 = []( xml_node& n ) {
         string attr( n.attribute( "path" ).value() );
         return (util::ends_with( attr, ".py" ));
@@ -19,6 +19,26 @@ int max_threads() {
     return 1;
 }
 
+Barrier::Barrier( size_t count, function<void()> on_complete )
+    : m_mutex(), m_cv(), m_count( count ), m_waiting( 0 ),
+      m_phase( 0 ), m_on_complete( move( on_complete ) ) {
+    ASSERT_( count > 0 );
+}
+
+void Barrier::arrive_and_wait() {
+    unique_lock<mutex> lock( m_mutex );
+    if( ++m_waiting == m_count ) {
+        if( m_on_complete )
+            m_on_complete();
+        m_waiting = 0;
+        ++m_phase;
+        m_cv.notify_all();
+        return;
+    }
+    auto phase = m_phase;
+    m_cv.wait( lock, [&]{ return m_phase != phase; } );
+}
+
 // Will take a vector of functions and will run  each  one  in  a
 // separate  thread. The functions are expected to take no parame-
 // ters  and  to  return  no values. This is a somewhat low-level
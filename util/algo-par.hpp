@@ -4,10 +4,14 @@
 #pragma once
 
 #include "error.hpp"
+#include "non-copyable.hpp"
+#include "trace.hpp"
 #include "util.hpp"
 
 #include <algorithm>
+#include <condition_variable>
 #include <functional>
+#include <mutex>
 #include <thread>
 #include <type_traits>
 #include <vector>
@@ -18,6 +22,31 @@ namespace util::par {
 // on this system. Result will always be >= 1.
 int max_threads();
 
+// Synchronization  point  for  a fixed number of threads: each call
+// to arrive_and_wait blocks until all of them have arrived. When
+// the last one arrives the completion function (if any)  is  run
+// by that thread before any are released, so it can safely update
+// state  shared by the threads between phases (it must not throw).
+// The barrier can be reused for any number of phases.
+class Barrier : util::non_copy_non_move {
+
+public:
+    explicit Barrier( size_t count,
+                      std::function<void()> on_complete = {} );
+
+    void arrive_and_wait();
+
+private:
+    std::mutex              m_mutex;
+    std::condition_variable m_cv;
+    size_t const            m_count;
+    size_t                  m_waiting;
+    // Incremented each time all threads arrive so that waiters
+    // can tell their phase has finished.
+    size_t                  m_phase;
+    std::function<void()>   m_on_complete;
+};
+
 // Will take a vector of functions and will run  each  one  in  a
 // separate  thread. The functions are expected to take no parame-
 // ters  and  to  return  no values. This is a somewhat low-level
@@ -69,6 +98,8 @@ auto map_safe( FuncT                      func,
     // One of the following functions will  be run in each thread.
     auto job = [&]( size_t job_idx ) -> void {
 
+        TRACE_SCOPE( "par::map_safe job" );
+
         // Divide up chunks so that threads don't contend for the
         // same memory.
         auto inc   = 1;
@@ -151,6 +182,8 @@ auto map( FuncT                      func,
     // One of the following functions will  be run in each thread.
     auto job = [&]( size_t job_idx ) -> void {
 
+        TRACE_SCOPE( "par::map job" );
+
         // Divide up chunks so that threads don't contend for the
         // same memory.
         auto inc   = 1;
@@ -240,6 +273,8 @@ void for_each( std::vector<InputT> const& input,
     // One of the following functions will  be run in each thread.
     auto job = [&]( size_t job_idx ) -> void {
 
+        TRACE_SCOPE( "par::for_each job" );
+
         // Divide up chunks so that threads don't contend for the
         // same memory.
         auto inc   = 1;
@@ -3,6 +3,10 @@
 ****************************************************************/
 #pragma once
 
+#include "macros.hpp"
+
+#include <algorithm>
+#include <array>
 #include <iterator>
 #include <vector>
 
@@ -60,6 +64,79 @@ auto lower_bound( Container const& c, UnaryFunc func )
     return first;
 }
 
+// Runs  lower_bound  for  a  whole batch of queries at once against
+// a sorted sequence of n elements, returning for each query the
+// index of the first element not less than it (n if none). The el-
+// ements are accessed only through the two functions:
+//
+//   bool        less( size_t i, Query const& q ) // elem[i] < q
+//   void const* addr( size_t i )                 // for prefetch
+//
+// If the queries are themselves sorted then this  is  a  merge:
+// each  search  starts where the previous one ended and gallops
+// forward, so the whole batch costs O(m*ln(n/m)) and walks the el-
+// ements in order. Otherwise the queries are processed in groups
+// whose  binary searches advance in lock step; each step  pref-
+// etches  the  next  probes of all searches in the group so that
+// their cache misses overlap instead of being paid one at a time.
+template<typename Query, typename LessFunc, typename AddrFunc>
+std::vector<size_t> batch_lower_bound(
+        size_t n, std::vector<Query> const& qs,
+        LessFunc less, AddrFunc addr ) {
+
+    std::vector<size_t> res( qs.size(), n );
+    if( n == 0 || qs.empty() )
+        return res;
+
+    if( std::is_sorted( std::begin( qs ), std::end( qs ) ) ) {
+        size_t lo = 0;
+        for( size_t qi = 0; qi < qs.size(); ++qi ) {
+            auto const& q = qs[qi];
+            // Invariant: all elements before lo are less than q.
+            if( lo < n && less( lo, q ) ) {
+                // Gallop to find a range (lo, hi] that contains
+                // the answer, then binary search within it.
+                size_t step = 1, hi = lo + 1;
+                while( hi < n && less( hi, q ) ) {
+                    lo = hi; step *= 2; hi = lo + step;
+                }
+                hi = std::min( hi, n );
+                ++lo;
+                while( lo < hi ) {
+                    size_t mid = lo + (hi-lo)/2;
+                    if( less( mid, q ) ) lo = mid+1;
+                    else                 hi = mid;
+                }
+            }
+            res[qi] = lo;
+        }
+        return res;
+    }
+
+    constexpr size_t group = 8;
+    std::array<size_t, group> base;
+    for( size_t g = 0; g < qs.size(); g += group ) {
+        size_t const m = std::min( group, qs.size() - g );
+        base.fill( 0 );
+        // All searches take the same number of steps since  they
+        // all halve the same length.
+        for( size_t len = n; len > 1; ) {
+            size_t half = len / 2;
+            for( size_t j = 0; j < m; ++j )
+                if( less( base[j] + half, qs[g+j] ) )
+                    base[j] += half;
+            len -= half;
+            // Now that the next probe of each search is known,
+            // start loading all of them together.
+            for( size_t j = 0; j < m; ++j )
+                PREFETCH( addr( base[j] + len/2 ) );
+        }
+        for( size_t j = 0; j < m; ++j )
+            res[g+j] = base[j] + size_t( less( base[j], qs[g+j] ) );
+    }
+    return res;
+}
+
 // Applies a function to each element of a vector, yielding a new
 // vector with the results. Function will be applied serially and
 // in order of the elements. Vector returned  will  be  pre  allo-
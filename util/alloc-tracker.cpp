@@ -0,0 +1,211 @@
+/****************************************************************
+* Allocation tracking
+****************************************************************/
+#include "alloc-tracker.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iomanip>
+#include <new>
+
+#ifdef TRACK_ALLOCATIONS
+#    if defined( __GLIBC__ )
+#        include <malloc.h>
+#        define ALLOC_USABLE_SIZE( p ) malloc_usable_size( p )
+#    elif defined( __APPLE__ )
+#        include <malloc/malloc.h>
+#        define ALLOC_USABLE_SIZE( p ) malloc_size( p )
+#    else
+#        error "TRACK_ALLOCATIONS is not supported on this platform"
+#    endif
+#endif
+
+using namespace std;
+
+namespace util {
+
+namespace {
+
+// Must be trivial so that the thread_local needs no construction
+// (which could itself allocate, or happen during an allocation).
+struct ThreadCounters {
+    uint64_t allocs;
+    uint64_t frees;
+    uint64_t bytes_allocated;
+    uint64_t bytes_freed;
+    int64_t  live;
+    int64_t  peak;
+    uint64_t size_histogram[64];
+};
+
+thread_local ThreadCounters t_counters;
+
+// Formats bytes with units chosen for readability.
+void write_bytes( ostream& out, double b ) {
+    char const* unit = "B";
+    for( char const* u : { "KB", "MB", "GB" } ) {
+        if( b < 1024.0 && b > -1024.0 ) break;
+        b /= 1024.0;
+        unit = u;
+    }
+    out << setprecision( 3 ) << b << unit;
+}
+
+} // anonymous namespace
+
+AllocStats thread_alloc_stats() {
+    auto const& c = t_counters;
+    AllocStats res;
+    res.allocs          = c.allocs;
+    res.frees           = c.frees;
+    res.bytes_allocated = c.bytes_allocated;
+    res.bytes_freed     = c.bytes_freed;
+    copy( begin( c.size_histogram ), end( c.size_histogram ),
+          res.size_histogram.begin() );
+    return res;
+}
+
+AllocStats operator-( AllocStats const& end, AllocStats const& start ) {
+    AllocStats res;
+    res.allocs          = end.allocs          - start.allocs;
+    res.frees           = end.frees           - start.frees;
+    res.bytes_allocated = end.bytes_allocated - start.bytes_allocated;
+    res.bytes_freed     = end.bytes_freed     - start.bytes_freed;
+    res.peak_live       = end.peak_live;
+    for( size_t i = 0; i < res.size_histogram.size(); ++i )
+        res.size_histogram[i] = end.size_histogram[i] -
+                                start.size_histogram[i];
+    return res;
+}
+
+ostream& operator<<( ostream& out, AllocStats const& s ) {
+    auto flags = out.flags();
+    auto prec  = out.precision();
+    out << "allocs=" << s.allocs << " frees=" << s.frees
+        << " bytes=";
+    write_bytes( out, double( s.bytes_allocated ) );
+    out << " live=";
+    write_bytes( out, double( s.live() ) );
+    out << " peak=";
+    write_bytes( out, double( s.peak_live ) );
+    out.flags( flags );
+    out.precision( prec );
+    return out;
+}
+
+AllocScope::AllocScope()
+    : m_start( thread_alloc_stats() ),
+      m_outer_peak( t_counters.peak ) {
+    t_counters.peak = t_counters.live;
+}
+
+AllocScope::~AllocScope() {
+    t_counters.peak = max( t_counters.peak, m_outer_peak );
+}
+
+AllocStats AllocScope::stats() const {
+    auto res = thread_alloc_stats() - m_start;
+    res.peak_live = t_counters.peak - m_start.live();
+    return res;
+}
+
+} // namespace util
+
+#ifdef TRACK_ALLOCATIONS
+
+namespace {
+
+int log2_bucket( size_t n ) {
+    int b = 0;
+    while( n >>= 1 ) ++b;
+    return b;
+}
+
+void on_alloc( void* p, size_t requested ) {
+    auto& c = util::t_counters;
+    auto  n = int64_t( ALLOC_USABLE_SIZE( p ) );
+    ++c.allocs;
+    c.bytes_allocated += uint64_t( n );
+    c.live += n;
+    c.peak  = std::max( c.peak, c.live );
+    ++c.size_histogram[log2_bucket( requested )];
+}
+
+void on_free( void* p ) {
+    auto& c = util::t_counters;
+    auto  n = int64_t( ALLOC_USABLE_SIZE( p ) );
+    ++c.frees;
+    c.bytes_freed += uint64_t( n );
+    c.live -= n;
+}
+
+void* tracked_alloc( size_t n ) noexcept {
+    void* p = std::malloc( n ? n : 1 );
+    if( p ) on_alloc( p, n );
+    return p;
+}
+
+void* tracked_alloc( size_t n, std::align_val_t al ) noexcept {
+    void* p     = nullptr;
+    auto  align = std::max( size_t( al ), sizeof( void* ) );
+    if( posix_memalign( &p, align, n ? n : 1 ) != 0 )
+        return nullptr;
+    on_alloc( p, n );
+    return p;
+}
+
+void tracked_free( void* p ) noexcept {
+    if( !p ) return;
+    on_free( p );
+    std::free( p );
+}
+
+template<typename... Args>
+void* tracked_alloc_or_throw( Args... args ) {
+    void* p = tracked_alloc( args... );
+    if( !p ) throw std::bad_alloc();
+    return p;
+}
+
+} // anonymous namespace
+
+void* operator new  ( size_t n ) { return tracked_alloc_or_throw( n ); }
+void* operator new[]( size_t n ) { return tracked_alloc_or_throw( n ); }
+
+void* operator new  ( size_t n, std::nothrow_t const& ) noexcept
+    { return tracked_alloc( n ); }
+void* operator new[]( size_t n, std::nothrow_t const& ) noexcept
+    { return tracked_alloc( n ); }
+
+void* operator new  ( size_t n, std::align_val_t al )
+    { return tracked_alloc_or_throw( n, al ); }
+void* operator new[]( size_t n, std::align_val_t al )
+    { return tracked_alloc_or_throw( n, al ); }
+
+void* operator new  ( size_t n, std::align_val_t al,
+                      std::nothrow_t const& ) noexcept
+    { return tracked_alloc( n, al ); }
+void* operator new[]( size_t n, std::align_val_t al,
+                      std::nothrow_t const& ) noexcept
+    { return tracked_alloc( n, al ); }
+
+void operator delete  ( void* p ) noexcept { tracked_free( p ); }
+void operator delete[]( void* p ) noexcept { tracked_free( p ); }
+void operator delete  ( void* p, size_t ) noexcept { tracked_free( p ); }
+void operator delete[]( void* p, size_t ) noexcept { tracked_free( p ); }
+
+void operator delete  ( void* p, std::nothrow_t const& ) noexcept
+    { tracked_free( p ); }
+void operator delete[]( void* p, std::nothrow_t const& ) noexcept
+    { tracked_free( p ); }
+
+void operator delete  ( void* p, std::align_val_t ) noexcept
+    { tracked_free( p ); }
+void operator delete[]( void* p, std::align_val_t ) noexcept
+    { tracked_free( p ); }
+void operator delete  ( void* p, size_t, std::align_val_t ) noexcept
+    { tracked_free( p ); }
+void operator delete[]( void* p, size_t, std::align_val_t ) noexcept
+    { tracked_free( p ); }
+
+#endif
@@ -0,0 +1,83 @@
+/****************************************************************
+* Allocation tracking
+****************************************************************/
+#pragma once
+
+#include "non-copyable.hpp"
+
+#include <array>
+#include <cstdint>
+#include <iostream>
+
+/****************************************************************
+* When  built  with TRACK_ALLOCATIONS defined, the global operator
+* new/delete are replaced by versions that count, per thread, the
+* allocations and frees made and the number of bytes in them (as
+* given  by  malloc_usable_size,  so  that  frees  can  be counted
+* without  knowing  their  size),  along  with  a  histogram  of
+* allocation sizes. Otherwise nothing is replaced  and  all  the
+* counts stay at zero.
+*
+* The counts are of the calling thread only, so memory allocated
+* on one thread and freed on another shows up as a free  on  the
+* latter (and live bytes may be negative).
+*
+* Note  that  the replacement operators live in alloc-tracker.cpp,
+* and so (when linking with the util library) will  only  be  lin-
+* ked  in  by  programs  that  use  something  from  this  header
+* (StopWatch does).
+****************************************************************/
+namespace util {
+
+#ifdef TRACK_ALLOCATIONS
+constexpr bool alloc_tracking_enabled = true;
+#else
+constexpr bool alloc_tracking_enabled = false;
+#endif
+
+struct AllocStats {
+    uint64_t allocs          = 0;
+    uint64_t frees           = 0;
+    uint64_t bytes_allocated = 0;
+    uint64_t bytes_freed     = 0;
+    // Highest number of live bytes, relative to the number live at
+    // the  start  of  the region; only measured by AllocScope (it
+    // is zero elsewhere).
+    int64_t  peak_live       = 0;
+    // Number of allocations whose requested size n had its highest
+    // set  bit  at  position  i  (i.e., 2^i <= n < 2^(i+1)), with
+    // zero-size requests in bucket 0.
+    std::array<uint64_t, 64> size_histogram = {};
+
+    int64_t live() const
+        { return int64_t( bytes_allocated - bytes_freed ); }
+};
+
+// Totals for the calling thread since it started.
+AllocStats thread_alloc_stats();
+
+// Counts between two snapshots; peak_live is taken from end.
+AllocStats operator-( AllocStats const& end, AllocStats const& start );
+
+// E.g. "allocs=12 frees=10 bytes=1.5KB live=64B peak=1KB".
+std::ostream& operator<<( std::ostream& out, AllocStats const& s );
+
+// Measures the allocations made by the calling thread between its
+// construction and the call to stats(), including the peak num-
+// ber of bytes live at any one time in between. Scopes may nest.
+class AllocScope : util::non_copy_non_move {
+
+public:
+    AllocScope();
+    ~AllocScope();
+
+    AllocStats stats() const;
+
+private:
+    AllocStats m_start;
+    // The thread's peak at construction, restored (if higher) on
+    // destruction so that enclosing scopes see the right peak.
+    int64_t    m_outer_peak;
+};
+
+} // namespace util
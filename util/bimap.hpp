@@ -8,9 +8,15 @@
 #include "util.hpp"
 
 #include <algorithm>
+#include <array>
+#include <cstdint>
 #include <functional>
+#include <memory>
 #include <optional>
+#include <stdexcept>
+#include <string_view>
 #include <tuple>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
@@ -68,6 +74,17 @@ public:
     ValT const& val( KeyT const& key ) const;
     KeyT const& key( ValT const& val ) const;
 
+    // Batch versions of the above, returning results in the  same
+    // order as the queries. These are faster than looking up each
+    // element individually; see util::batch_lower_bound.
+    std::vector<OptRef<ValT const>>
+    vals_of_safe( std::vector<KeyT> const& keys ) const;
+    std::vector<OptRef<KeyT const>>
+    keys_of_safe( std::vector<ValT> const& vals ) const;
+
+    std::vector<ValT> vals_of( std::vector<KeyT> const& keys ) const;
+    std::vector<KeyT> keys_of( std::vector<ValT> const& vals ) const;
+
     // Will yield tuples as values like STL map containers.
     const_iterator begin() const { return m_data.begin(); }
     const_iterator end()   const { return m_data.end();   }
@@ -76,6 +93,13 @@ private:
 
     using ref_type = std::reference_wrapper<value_type const>;
 
+    // Batch lookup in one of the two directions; I is the index
+    // of the element in the tuples being searched for.
+    template<size_t I, typename T>
+    std::vector<OptRef<std::tuple_element_t<1-I, value_type> const>>
+    batch_lookup( std::vector<ref_type> const& refs,
+                  std::vector<T> const& qs ) const;
+
     // Helper to facilitate sharing code between constructors.
     void initialize( bool sorted );
 
@@ -220,6 +244,286 @@ KeyT const& BiMapFixed<KeyT, ValT>::key( ValT const& val ) const {
     return *k;
 }
 
+namespace impl {
+
+// Maps a hash onto a power-of-two table with 2^(64-shift) slots
+// using Fibonacci hashing: std::hash is the identity for integers
+// on common implementations, so this spreads them across the table
+// instead of just taking the low bits.
+inline size_t hash_slot( size_t hash, int shift ) {
+    if( shift >= 64 ) return 0;
+    return size_t( (uint64_t( hash ) * 0x9E3779B97F4A7C15ull)
+                   >> shift );
+}
+
+/****************************************************************
+* ProbeTable
+*
+* An  open-addressed,  linear-probed table of 32-bit indices into
+* some  external  vector of elements; it does not store the elem-
+* ents  (or  their hashes) itself, so the caller supplies both the
+* hash  and an equality predicate. The table is sized to a power
+* of two that is at least twice the number of elements, so  probe
+* sequences stay short. It is filled once and never shrinks.
+****************************************************************/
+class ProbeTable {
+
+public:
+    static constexpr uint32_t empty = uint32_t( -1 );
+
+    ProbeTable() : m_slots(), m_shift( 64 ) {}
+
+    explicit ProbeTable( size_t n ) : m_slots(), m_shift( 64 ) {
+        ASSERT( n < empty, "too many elements for ProbeTable" );
+        size_t size = 1;
+        while( size < 2*n ) { size *= 2; --m_shift; }
+        m_slots.assign( size, empty );
+    }
+
+    // Returns the index of the element for which eq( idx ) holds.
+    template<typename EqFunc>
+    std::optional<uint32_t> find( size_t hash, EqFunc eq ) const {
+        if( m_slots.empty() )
+            return std::nullopt;
+        size_t mask = m_slots.size() - 1;
+        for( size_t i = slot_of( hash ); ; i = (i+1) & mask ) {
+            uint32_t idx = m_slots[i];
+            if( idx == empty )
+                return std::nullopt;
+            if( eq( idx ) )
+                return idx;
+        }
+    }
+
+    // Precondition: there is no element already with this hash
+    // that is equal to the one at idx.
+    void insert( size_t hash, uint32_t idx ) {
+        size_t mask = m_slots.size() - 1;
+        size_t i = slot_of( hash );
+        while( m_slots[i] != empty )
+            i = (i+1) & mask;
+        m_slots[i] = idx;
+    }
+
+private:
+    size_t slot_of( size_t hash ) const
+        { return hash_slot( hash, m_shift ); }
+
+    std::vector<uint32_t> m_slots;
+    int                   m_shift;
+};
+
+} // namespace impl
+
+/****************************************************************
+* BiMapHashed
+*
+* Same  interface  and  semantics  as  BiMapFixed, but lookups in
+* either direction are O(1) on average instead of  O(ln(N)).  The
+* data  is  still held only once (sorted by key so that iteration
+* order matches BiMapFixed), and each direction  is  indexed  by
+* a  ProbeTable  of 32-bit slots pointing into it, so a lookup is
+* one hash plus a short scan of contiguous memory rather than a
+* binary search with an indirection at every step.
+*
+* Prefer  this  class  when the map is queried far more often than
+* it is built; BiMapFixed has less memory overhead and does not
+* need the key/value types to be hashable.
+****************************************************************/
+template<typename KeyT, typename ValT,
+         typename KeyHash = std::hash<KeyT>,
+         typename ValHash = std::hash<ValT>>
+class BiMapHashed : util::movable_only {
+
+public:
+
+    using value_type = std::tuple<KeyT, ValT>;
+
+    using const_iterator =
+            typename std::vector<value_type>::const_iterator;
+
+    // If  sorted is false then the data will be sorted according
+    // to the first element in the pair.
+    explicit BiMapHashed( std::vector<value_type>&& data,
+                          bool sorted = false );
+
+    // Data will be sorted according to the first element in pair.
+    BiMapHashed( std::initializer_list<value_type> data );
+
+    // Returns #keys (== #values)
+    size_t size() const { return m_data.size(); }
+
+    // Returns an optional  of  reference,  so  no copying/moving
+    // should happen here.
+    OptRef<ValT const> val_safe( KeyT const& key ) const;
+    OptRef<KeyT const> key_safe( ValT const& val ) const;
+
+    // These variants will throw exceptions when key/val  is  not
+    // found.
+    ValT const& val( KeyT const& key ) const;
+    KeyT const& key( ValT const& val ) const;
+
+    // Will yield tuples as values like STL map containers.
+    const_iterator begin() const { return m_data.begin(); }
+    const_iterator end()   const { return m_data.end();   }
+
+private:
+
+    // Helper to facilitate sharing code between constructors.
+    void initialize( bool sorted );
+
+    impl::ProbeTable        m_by_key;
+    impl::ProbeTable        m_by_val;
+
+    // Only one copy of each key/value is held here.
+    std::vector<value_type> m_data;
+};
+
+template<typename KeyT, typename ValT, typename KH, typename VH>
+typename BiMapHashed<KeyT, ValT, KH, VH>::const_iterator begin(
+        BiMapHashed<KeyT, ValT, KH, VH> const& bmh )
+    { return bmh.begin(); }
+
+template<typename KeyT, typename ValT, typename KH, typename VH>
+typename BiMapHashed<KeyT, ValT, KH, VH>::const_iterator end(
+        BiMapHashed<KeyT, ValT, KH, VH> const& bmh )
+    { return bmh.end(); }
+
+template<typename KeyT, typename ValT, typename KH, typename VH>
+void BiMapHashed<KeyT, ValT, KH, VH>::initialize( bool sorted ) {
+
+    auto lt_fst = []( value_type const& r1, value_type const& r2 )
+        { return std::get<0>( r1 ) < std::get<0>( r2 ); };
+
+    if( !sorted )
+        std::sort( std::begin( m_data ), std::end( m_data ),
+                   lt_fst );
+
+    m_by_key = impl::ProbeTable( m_data.size() );
+    m_by_val = impl::ProbeTable( m_data.size() );
+
+    for( uint32_t i = 0; i < uint32_t( m_data.size() ); ++i ) {
+        m_by_key.insert( KH{}( std::get<0>( m_data[i] ) ), i );
+        m_by_val.insert( VH{}( std::get<1>( m_data[i] ) ), i );
+    }
+}
+
+template<typename KeyT, typename ValT, typename KH, typename VH>
+BiMapHashed<KeyT, ValT, KH, VH>::BiMapHashed(
+    std::vector<value_type>&& data,
+    bool sorted ) : m_by_key(), m_by_val(), m_data( move( data ) )
+{
+    initialize( sorted );
+}
+
+template<typename KeyT, typename ValT, typename KH, typename VH>
+BiMapHashed<KeyT, ValT, KH, VH>::BiMapHashed(
+        std::initializer_list<value_type> data )
+      : m_by_key(), m_by_val(), m_data( data ) {
+
+    initialize( false );
+}
+
+template<typename KeyT, typename ValT, typename KH, typename VH>
+OptRef<ValT const>
+BiMapHashed<KeyT, ValT, KH, VH>::val_safe( KeyT const& key ) const {
+
+    auto i = m_by_key.find( KH{}( key ), [&]( uint32_t idx ) {
+        return std::get<0>( m_data[idx] ) == key;
+    });
+    if( !i )
+        return std::nullopt;
+    return std::get<1>( m_data[*i] );
+}
+
+template<typename KeyT, typename ValT, typename KH, typename VH>
+OptRef<KeyT const>
+BiMapHashed<KeyT, ValT, KH, VH>::key_safe( ValT const& val ) const {
+
+    auto i = m_by_val.find( VH{}( val ), [&]( uint32_t idx ) {
+        return std::get<1>( m_data[idx] ) == val;
+    });
+    if( !i )
+        return std::nullopt;
+    return std::get<0>( m_data[*i] );
+}
+
+template<typename KeyT, typename ValT, typename KH, typename VH>
+ValT const&
+BiMapHashed<KeyT, ValT, KH, VH>::val( KeyT const& key ) const {
+    auto const& v = val_safe( key );
+    ASSERT( v, "key not found in BiMapHashed" );
+    return *v;
+}
+
+template<typename KeyT, typename ValT, typename KH, typename VH>
+KeyT const&
+BiMapHashed<KeyT, ValT, KH, VH>::key( ValT const& val ) const {
+    auto const& k = key_safe( val );
+    ASSERT( k, "value not found in BiMapHashed" );
+    return *k;
+}
+
+template<typename KeyT, typename ValT>
+template<size_t I, typename T>
+std::vector<OptRef<std::tuple_element_t<
+    1-I, typename BiMapFixed<KeyT, ValT>::value_type> const>>
+BiMapFixed<KeyT, ValT>::batch_lookup(
+        std::vector<ref_type> const& refs,
+        std::vector<T> const& qs ) const {
+
+    auto idxs = util::batch_lower_bound( refs.size(), qs,
+        [&]( size_t i, T const& q ) {
+            return std::get<I>( refs[i].get() ) < q; },
+        [&]( size_t i ) -> void const* {
+            return &refs[i].get(); } );
+
+    std::vector<OptRef<std::tuple_element_t<1-I, value_type> const>>
+        res; res.reserve( qs.size() );
+    for( size_t i = 0; i < qs.size(); ++i ) {
+        if( idxs[i] < refs.size() &&
+            std::get<I>( refs[idxs[i]].get() ) == qs[i] )
+            res.emplace_back( std::get<1-I>( refs[idxs[i]].get() ) );
+        else
+            res.emplace_back( std::nullopt );
+    }
+    return res;
+}
+
+template<typename KeyT, typename ValT>
+std::vector<OptRef<ValT const>> BiMapFixed<KeyT, ValT>::vals_of_safe(
+        std::vector<KeyT> const& keys ) const {
+    return batch_lookup<0>( m_by_key, keys );
+}
+
+template<typename KeyT, typename ValT>
+std::vector<OptRef<KeyT const>> BiMapFixed<KeyT, ValT>::keys_of_safe(
+        std::vector<ValT> const& vals ) const {
+    return batch_lookup<1>( m_by_val, vals );
+}
+
+template<typename KeyT, typename ValT>
+std::vector<ValT> BiMapFixed<KeyT, ValT>::vals_of(
+        std::vector<KeyT> const& keys ) const {
+    std::vector<ValT> res; res.reserve( keys.size() );
+    for( auto const& v : vals_of_safe( keys ) ) {
+        ASSERT( v, "key not found in BiMapFixed" );
+        res.push_back( *v );
+    }
+    return res;
+}
+
+template<typename KeyT, typename ValT>
+std::vector<KeyT> BiMapFixed<KeyT, ValT>::keys_of(
+        std::vector<ValT> const& vals ) const {
+    std::vector<KeyT> res; res.reserve( vals.size() );
+    for( auto const& k : keys_of_safe( vals ) ) {
+        ASSERT( k, "value not found in BiMapFixed" );
+        res.push_back( *k );
+    }
+    return res;
+}
+
 /****************************************************************
 * BDIndexMap ("Bi-directional map with increasing ints as keys")
 *
@@ -238,7 +542,21 @@ KeyT const& BiMapFixed<KeyT, ValT>::key( ValT const& val ) const {
 *      for the keys.
 *
 * Values are returned as optional references.
+*
+* By default the value->key lookup is a binary search over the so-
+* rted values, which for large maps incurs a cache miss on nearly
+* every probe. Constructing with SearchLayout::eytzinger adds  a
+* second copy of the values stored in "Eytzinger"  (breadth-first
+* tree)  order,  where  the children of node k are at 2k and 2k+1.
+* The  search  then  walks  down  that  array  with no unpredict-
+* able branches, and since the nodes four levels down are contig-
+* uous  they  can be prefetched while the current ones are being
+* compared. This costs one extra copy of the values plus a 32-bit
+* index  per value, so it is only worth it for maps that are large
+* and queried often. The key->value direction is always O(1).
 ****************************************************************/
+enum class SearchLayout { sorted, eytzinger };
+
 template<typename T> class BDIndexMap : util::movable_only {
 
 public:
@@ -248,7 +566,9 @@ public:
     // done for you. If you don't do this then this class may not
     // function properly.
     explicit BDIndexMap( std::vector<T>&& data,
-                         bool             is_uniq_sorted = false );
+                         bool             is_uniq_sorted = false,
+                         SearchLayout     layout =
+                                              SearchLayout::sorted );
 
     // Returns #keys (== #values)
     size_t size() const { return m_data.size(); }
@@ -263,24 +583,99 @@ public:
     T const& val( size_t   n   ) const;
     size_t   key( T const& val ) const;
 
+    // Batch versions of the above, returning results in the  same
+    // order  as  the queries. keys_of is faster than calling key()
+    // for each element; see util::batch_lower_bound.
+    std::vector<std::optional<size_t>>
+                        keys_of_safe( std::vector<T> const& vals ) const;
+    std::vector<size_t> keys_of( std::vector<T> const& vals ) const;
+    std::vector<T>      vals_of( std::vector<size_t> const& ns ) const;
+
 private:
 
+    // Fills in m_eytz/m_eytz_idx from the subtree rooted at node k
+    // with the sorted values starting at index i; returns the next
+    // unused index.
+    size_t build_eytzinger( size_t i, size_t k );
+
+    std::optional<size_t> key_safe_eytzinger( T const& val ) const;
+
     std::vector<T> m_data;
+
+    // Only populated for SearchLayout::eytzinger. Both are one-
+    // based (element zero is unused) and m_eytz_idx gives the in-
+    // dex into m_data of each node.
+    std::vector<T>        m_eytz;
+    std::vector<uint32_t> m_eytz_idx;
 };
 
 template<typename T>
 BDIndexMap<T>::BDIndexMap( std::vector<T>&& data,
-                           bool is_uniq_sorted )
-    : m_data( move( data ) ) {
+                           bool is_uniq_sorted,
+                           SearchLayout layout )
+    : m_data( move( data ) ), m_eytz(), m_eytz_idx() {
 
     if( !is_uniq_sorted )
         util::uniq_sort( m_data );
+
+    if( layout == SearchLayout::eytzinger ) {
+        ASSERT( m_data.size() < uint32_t( -1 ),
+                "too many elements for eytzinger layout" );
+        m_eytz.resize( m_data.size() + 1 );
+        m_eytz_idx.resize( m_data.size() + 1 );
+        build_eytzinger( 0, 1 );
+    }
+}
+
+template<typename T>
+size_t BDIndexMap<T>::build_eytzinger( size_t i, size_t k ) {
+
+    // In-order traversal of the implicit tree visits nodes in so-
+    // rted order.
+    if( k <= m_data.size() ) {
+        i = build_eytzinger( i, 2*k );
+        m_eytz[k]     = m_data[i];
+        m_eytz_idx[k] = uint32_t( i++ );
+        i = build_eytzinger( i, 2*k+1 );
+    }
+    return i;
+}
+
+template<typename T>
+std::optional<size_t>
+BDIndexMap<T>::key_safe_eytzinger( T const& val ) const {
+
+    size_t const n = m_data.size();
+    T const*     e = m_eytz.data();
+
+    // Descend, going right whenever the node is less than val;
+    // the node sixteen times further along is four levels down
+    // and is where we'll be (roughly) four iterations from now.
+    size_t k = 1;
+    while( k <= n ) {
+        PREFETCH( e + std::min( 16*k, n ) );
+        k = 2*k + size_t( e[k] < val );
+    }
+    // k's path ends with a (possibly empty) run of right turns
+    // (one bits) after the last left turn; the node where we last
+    // turned left is the lower bound, so strip them along with
+    // that left turn.
+    while( k & 1 ) k >>= 1;
+    k >>= 1;
+
+    if( k != 0 && m_eytz[k] == val )
+        return m_eytz_idx[k];
+
+    return std::nullopt;
 }
 
 template<typename T>
 std::optional<size_t>
 BDIndexMap<T>::key_safe( T const& val ) const {
 
+    if( !m_eytz.empty() )
+        return key_safe_eytzinger( val );
+
     auto i = std::lower_bound(
                 std::begin( m_data ), std::end( m_data ), val );
 
@@ -290,6 +685,46 @@ BDIndexMap<T>::key_safe( T const& val ) const {
     return std::nullopt;
 }
 
+template<typename T>
+std::vector<std::optional<size_t>>
+BDIndexMap<T>::keys_of_safe( std::vector<T> const& vals ) const {
+
+    auto idxs = util::batch_lower_bound( m_data.size(), vals,
+        [this]( size_t i, T const& q ) { return m_data[i] < q; },
+        [this]( size_t i ) -> void const* { return &m_data[i]; } );
+
+    std::vector<std::optional<size_t>> res; res.reserve( vals.size() );
+    for( size_t i = 0; i < vals.size(); ++i ) {
+        if( idxs[i] < m_data.size() && m_data[idxs[i]] == vals[i] )
+            res.emplace_back( idxs[i] );
+        else
+            res.emplace_back( std::nullopt );
+    }
+    return res;
+}
+
+template<typename T>
+std::vector<size_t>
+BDIndexMap<T>::keys_of( std::vector<T> const& vals ) const {
+
+    std::vector<size_t> res; res.reserve( vals.size() );
+    for( auto const& k : keys_of_safe( vals ) ) {
+        ASSERT( k, "value not found in bimap" );
+        res.push_back( *k );
+    }
+    return res;
+}
+
+template<typename T>
+std::vector<T>
+BDIndexMap<T>::vals_of( std::vector<size_t> const& ns ) const {
+
+    std::vector<T> res; res.reserve( ns.size() );
+    for( auto n : ns )
+        res.push_back( val( n ) );
+    return res;
+}
+
 template<typename T>
 size_t BDIndexMap<T>::key( T const& val ) const {
 
@@ -315,4 +750,570 @@ T const& BDIndexMap<T>::val( size_t n ) const {
     return m_data[n];
 }
 
+/****************************************************************
+* BiMap ("Mutable Bi-directional Map")
+*
+* Like  BiMapFixed  this  maps unique keys to unique values 1-to-1,
+* but elements can be inserted and erased at any time; all opera-
+* tions (insert, erase, and lookup in either direction)  take  am-
+* ortized O(1) time.
+*
+* Each (key, value) pair is stored once in a node  pool  made  of
+* fixed-size chunks that are never moved, so references returned
+* by  lookups  remain  valid until the element is erased. Erased
+* nodes go on a free list and are reused by later inserts, so  a
+* long-lived map with churn does not keep allocating. Two open-ad-
+* dressed  tables  (one  hashed by key, one by value) hold 32-bit
+* indices into the pool; the nodes cache both hashes so that  re-
+* hashing  never  needs  to rehash the keys or values themselves.
+* Deletion from the tables uses backward-shift, so there are  no
+* tombstones and lookups don't degrade after many erases.
+*
+* insert returns a Handle which identifies the element until it is
+* erased  and  can  be used to access or erase it without hashing.
+* After an element is erased its handle must not be used again
+* (it may refer to a later element that reused the node).
+****************************************************************/
+template<typename KeyT, typename ValT,
+         typename KeyHash = std::hash<KeyT>,
+         typename ValHash = std::hash<ValT>>
+class BiMap : util::movable_only {
+
+public:
+
+    using value_type = std::tuple<KeyT, ValT>;
+
+    class Handle {
+    public:
+        bool operator==( Handle rhs ) const
+            { return m_idx == rhs.m_idx; }
+        bool operator!=( Handle rhs ) const
+            { return m_idx != rhs.m_idx; }
+    private:
+        friend class BiMap;
+        explicit Handle( uint32_t idx ) : m_idx( idx ) {}
+        uint32_t m_idx;
+    };
+
+    BiMap();
+
+    size_t size()  const { return m_size; }
+    bool   empty() const { return m_size == 0; }
+
+    // Makes room for at least n elements so that inserting that
+    // many will not cause any allocation or rehashing.
+    void reserve( size_t n );
+
+    // Fails  (returning nullopt and leaving the map unchanged) if
+    // either the key or the value is already in the map.
+    std::optional<Handle> insert( KeyT key, ValT val );
+
+    // These return false if the key/val was not found.
+    bool erase_key( KeyT const& key );
+    bool erase_val( ValT const& val );
+    void erase( Handle h );
+
+    std::optional<Handle> find_key( KeyT const& key ) const;
+    std::optional<Handle> find_val( ValT const& val ) const;
+
+    value_type const& get( Handle h ) const;
+
+    // Returns an optional  of  reference,  so  no copying/moving
+    // should happen here.
+    OptRef<ValT const> val_safe( KeyT const& key ) const;
+    OptRef<KeyT const> key_safe( ValT const& val ) const;
+
+    // These variants will throw exceptions when key/val  is  not
+    // found.
+    ValT const& val( KeyT const& key ) const;
+    KeyT const& key( ValT const& val ) const;
+
+    // Calls f( key, val ) on each element in unspecified order.
+    template<typename Func>
+    void for_each( Func f ) const;
+
+private:
+
+    static constexpr uint32_t none       = uint32_t( -1 );
+    static constexpr size_t   chunk_bits = 8;
+    static constexpr size_t   chunk_size = size_t( 1 ) << chunk_bits;
+
+    struct Node {
+        std::optional<value_type> data;
+        // Index 0 is the hash of the key, 1 that of the value.
+        std::array<size_t, 2>     hashes    = {};
+        uint32_t                  next_free = none;
+    };
+
+    Node& node( uint32_t idx )
+        { return m_chunks[idx >> chunk_bits][idx & (chunk_size-1)]; }
+    Node const& node( uint32_t idx ) const
+        { return m_chunks[idx >> chunk_bits][idx & (chunk_size-1)]; }
+
+    uint32_t alloc_node();
+    void     free_node( uint32_t idx );
+
+    // In the following, I selects the table: 0 for keys, 1 for
+    // values.
+
+    // Returns the position in the table of the slot holding the
+    // node whose I'th element equals x.
+    template<size_t I, typename T>
+    std::optional<size_t> find_slot( size_t hash, T const& x ) const;
+
+    template<size_t I>
+    void insert_slot( uint32_t idx );
+
+    template<size_t I>
+    void erase_slot( size_t pos );
+
+    // Removes node idx from both tables and frees it.
+    void erase_node( uint32_t idx );
+
+    // Rebuilds both tables with 2^(64-shift) slots each.
+    void rehash( int shift );
+
+    std::vector<std::unique_ptr<Node[]>>  m_chunks;
+    // Number of nodes ever handed out from the chunks.
+    uint32_t                              m_used;
+    uint32_t                              m_free;
+    size_t                                m_size;
+    std::array<std::vector<uint32_t>, 2>  m_tables;
+    int                                   m_shift;
+};
+
+template<typename KeyT, typename ValT, typename KH, typename VH>
+BiMap<KeyT, ValT, KH, VH>::BiMap()
+    : m_chunks(), m_used( 0 ), m_free( none ), m_size( 0 ),
+      m_tables(), m_shift( 64 ) {}
+
+template<typename KeyT, typename ValT, typename KH, typename VH>
+void BiMap<KeyT, ValT, KH, VH>::reserve( size_t n ) {
+
+    ASSERT( n < none, "too many elements for BiMap" );
+    while( m_chunks.size()*chunk_size < n )
+        m_chunks.emplace_back( new Node[chunk_size] );
+    // Keep the load factor at or below one half.
+    int shift = m_shift;
+    while( (size_t( 1 ) << (64-shift)) < 2*n ) --shift;
+    if( shift != m_shift )
+        rehash( shift );
+}
+
+template<typename KeyT, typename ValT, typename KH, typename VH>
+uint32_t BiMap<KeyT, ValT, KH, VH>::alloc_node() {
+
+    if( m_free != none ) {
+        uint32_t idx = m_free;
+        m_free = node( idx ).next_free;
+        return idx;
+    }
+    ASSERT( m_used < none-1, "too many elements for BiMap" );
+    if( m_used == m_chunks.size()*chunk_size )
+        m_chunks.emplace_back( new Node[chunk_size] );
+    return m_used++;
+}
+
+template<typename KeyT, typename ValT, typename KH, typename VH>
+void BiMap<KeyT, ValT, KH, VH>::free_node( uint32_t idx ) {
+
+    auto& n = node( idx );
+    n.data.reset();
+    n.next_free = m_free;
+    m_free = idx;
+}
+
+template<typename KeyT, typename ValT, typename KH, typename VH>
+template<size_t I, typename T>
+std::optional<size_t> BiMap<KeyT, ValT, KH, VH>::find_slot(
+        size_t hash, T const& x ) const {
+
+    auto const& table = m_tables[I];
+    if( table.empty() )
+        return std::nullopt;
+    size_t mask = table.size() - 1;
+    for( size_t i = impl::hash_slot( hash, m_shift ); ;
+         i = (i+1) & mask ) {
+        uint32_t idx = table[i];
+        if( idx == none )
+            return std::nullopt;
+        auto const& n = node( idx );
+        if( n.hashes[I] == hash && std::get<I>( *n.data ) == x )
+            return i;
+    }
+}
+
+template<typename KeyT, typename ValT, typename KH, typename VH>
+template<size_t I>
+void BiMap<KeyT, ValT, KH, VH>::insert_slot( uint32_t idx ) {
+
+    auto& table = m_tables[I];
+    size_t mask = table.size() - 1;
+    size_t i = impl::hash_slot( node( idx ).hashes[I], m_shift );
+    while( table[i] != none )
+        i = (i+1) & mask;
+    table[i] = idx;
+}
+
+template<typename KeyT, typename ValT, typename KH, typename VH>
+template<size_t I>
+void BiMap<KeyT, ValT, KH, VH>::erase_slot( size_t pos ) {
+
+    auto& table = m_tables[I];
+    size_t mask = table.size() - 1;
+    // Move back any following elements in the same run that would
+    // no longer be reachable from their home slot across the hole.
+    for( size_t j = (pos+1) & mask; table[j] != none;
+         j = (j+1) & mask ) {
+        size_t home = impl::hash_slot(
+            node( table[j] ).hashes[I], m_shift );
+        // Distance (mod table size) from home to j versus from
+        // home to the hole; if the hole is in between, fill it.
+        if( ((j - home) & mask) >= ((j - pos) & mask) ) {
+            table[pos] = table[j];
+            pos = j;
+        }
+    }
+    table[pos] = none;
+}
+
+template<typename KeyT, typename ValT, typename KH, typename VH>
+void BiMap<KeyT, ValT, KH, VH>::rehash( int shift ) {
+
+    m_shift = shift;
+    for( auto& table : m_tables )
+        table.assign( size_t( 1 ) << (64-shift), none );
+    for( uint32_t idx = 0; idx < m_used; ++idx ) {
+        if( !node( idx ).data )
+            continue;
+        insert_slot<0>( idx );
+        insert_slot<1>( idx );
+    }
+}
+
+template<typename KeyT, typename ValT, typename KH, typename VH>
+std::optional<typename BiMap<KeyT, ValT, KH, VH>::Handle>
+BiMap<KeyT, ValT, KH, VH>::insert( KeyT key, ValT val ) {
+
+    size_t kh = KH{}( key ), vh = VH{}( val );
+    if( find_slot<0>( kh, key ) || find_slot<1>( vh, val ) )
+        return std::nullopt;
+
+    if( 2*(m_size+1) > m_tables[0].size() )
+        rehash( m_tables[0].empty() ? 64-4 : m_shift-1 );
+
+    uint32_t idx = alloc_node();
+    auto& n = node( idx );
+    n.data.emplace( std::move( key ), std::move( val ) );
+    n.hashes = { kh, vh };
+    insert_slot<0>( idx );
+    insert_slot<1>( idx );
+    ++m_size;
+    return Handle( idx );
+}
+
+template<typename KeyT, typename ValT, typename KH, typename VH>
+void BiMap<KeyT, ValT, KH, VH>::erase_node( uint32_t idx ) {
+
+    auto const& n = node( idx );
+    // Each node is in each table exactly once, so these must be
+    // found.
+    auto ks = find_slot<0>( n.hashes[0], std::get<0>( *n.data ) );
+    auto vs = find_slot<1>( n.hashes[1], std::get<1>( *n.data ) );
+    erase_slot<0>( *ks );
+    erase_slot<1>( *vs );
+    free_node( idx );
+    --m_size;
+}
+
+template<typename KeyT, typename ValT, typename KH, typename VH>
+bool BiMap<KeyT, ValT, KH, VH>::erase_key( KeyT const& key ) {
+    auto h = find_key( key );
+    if( h ) erase( *h );
+    return bool( h );
+}
+
+template<typename KeyT, typename ValT, typename KH, typename VH>
+bool BiMap<KeyT, ValT, KH, VH>::erase_val( ValT const& val ) {
+    auto h = find_val( val );
+    if( h ) erase( *h );
+    return bool( h );
+}
+
+template<typename KeyT, typename ValT, typename KH, typename VH>
+void BiMap<KeyT, ValT, KH, VH>::erase( Handle h ) {
+    ASSERT( h.m_idx < m_used && node( h.m_idx ).data,
+            "invalid handle passed to BiMap::erase" );
+    erase_node( h.m_idx );
+}
+
+template<typename KeyT, typename ValT, typename KH, typename VH>
+std::optional<typename BiMap<KeyT, ValT, KH, VH>::Handle>
+BiMap<KeyT, ValT, KH, VH>::find_key( KeyT const& key ) const {
+    auto s = find_slot<0>( KH{}( key ), key );
+    if( !s ) return std::nullopt;
+    return Handle( m_tables[0][*s] );
+}
+
+template<typename KeyT, typename ValT, typename KH, typename VH>
+std::optional<typename BiMap<KeyT, ValT, KH, VH>::Handle>
+BiMap<KeyT, ValT, KH, VH>::find_val( ValT const& val ) const {
+    auto s = find_slot<1>( VH{}( val ), val );
+    if( !s ) return std::nullopt;
+    return Handle( m_tables[1][*s] );
+}
+
+template<typename KeyT, typename ValT, typename KH, typename VH>
+typename BiMap<KeyT, ValT, KH, VH>::value_type const&
+BiMap<KeyT, ValT, KH, VH>::get( Handle h ) const {
+    ASSERT( h.m_idx < m_used && node( h.m_idx ).data,
+            "invalid handle passed to BiMap::get" );
+    return *node( h.m_idx ).data;
+}
+
+template<typename KeyT, typename ValT, typename KH, typename VH>
+OptRef<ValT const>
+BiMap<KeyT, ValT, KH, VH>::val_safe( KeyT const& key ) const {
+    auto h = find_key( key );
+    if( !h ) return std::nullopt;
+    return std::get<1>( *node( h->m_idx ).data );
+}
+
+template<typename KeyT, typename ValT, typename KH, typename VH>
+OptRef<KeyT const>
+BiMap<KeyT, ValT, KH, VH>::key_safe( ValT const& val ) const {
+    auto h = find_val( val );
+    if( !h ) return std::nullopt;
+    return std::get<0>( *node( h->m_idx ).data );
+}
+
+template<typename KeyT, typename ValT, typename KH, typename VH>
+ValT const& BiMap<KeyT, ValT, KH, VH>::val( KeyT const& key ) const {
+    auto const& v = val_safe( key );
+    ASSERT( v, "key not found in BiMap" );
+    return *v;
+}
+
+template<typename KeyT, typename ValT, typename KH, typename VH>
+KeyT const& BiMap<KeyT, ValT, KH, VH>::key( ValT const& val ) const {
+    auto const& k = key_safe( val );
+    ASSERT( k, "value not found in BiMap" );
+    return *k;
+}
+
+template<typename KeyT, typename ValT, typename KH, typename VH>
+template<typename Func>
+void BiMap<KeyT, ValT, KH, VH>::for_each( Func f ) const {
+    for( uint32_t idx = 0; idx < m_used; ++idx )
+        if( auto const& d = node( idx ).data; d )
+            f( std::get<0>( *d ), std::get<1>( *d ) );
+}
+
+/****************************************************************
+* StaticBiMap ("Compile-time Bi-directional Map")
+*
+* Maps  a  fixed  set  of  string  keys to enum (or integral) val-
+* ues and back, where the whole map can be  built  at  compile
+* time, e.g.:
+*
+*   inline constexpr StaticBiMap<Color, 2> g_colors{ {
+*       { "red", Color::red }, { "blue", Color::blue }
+*   } };
+*
+* so  that  there  is no static initialization and no allocation.
+* Construction sorts the entries by key (so iteration  is  in  key
+* order) and searches for a seed for which a simple string hash is
+* a perfect hash of the keys into a small table; string  lookups
+* then  cost  one  hash  and one string comparison. If no such seed
+* is  found  (only likely for large maps) lookups fall back to bi-
+* nary search. When the values are exactly 0..N-1 (the usual case
+* for  enums)  mapping  from  value to key is a direct index, other-
+* wise it is a binary search.
+*
+* Duplicate keys or values are a compile error when the map is
+* constexpr and throw otherwise.
+****************************************************************/
+template<typename ValT, size_t N>
+class StaticBiMap {
+
+    static_assert( std::is_enum_v<ValT> || std::is_integral_v<ValT>,
+                   "StaticBiMap values must be enums or integers" );
+
+public:
+    struct value_type {
+        std::string_view key = {};
+        ValT             val = {};
+    };
+
+    using const_iterator = value_type const*;
+
+    constexpr explicit StaticBiMap( value_type const (&data)[N] );
+
+    constexpr size_t size() const { return N; }
+
+    constexpr std::optional<ValT>
+    val_safe( std::string_view key ) const;
+
+    constexpr std::optional<std::string_view>
+    key_safe( ValT val ) const;
+
+    // These variants will throw exceptions when key/val  is  not
+    // found.
+    ValT             val( std::string_view key ) const;
+    std::string_view key( ValT val ) const;
+
+    // Yields entries in order sorted by key.
+    constexpr const_iterator begin() const { return m_data.data(); }
+    constexpr const_iterator end()   const
+        { return m_data.data() + N; }
+
+private:
+    using ord_type = std::conditional_t<
+        std::is_enum_v<ValT>, std::underlying_type<ValT>,
+        std::common_type<ValT>>;
+
+    static constexpr auto ord( ValT v ) {
+        return static_cast<typename ord_type::type>( v );
+    }
+
+    static constexpr uint64_t hash( std::string_view s,
+                                    uint64_t seed ) {
+        uint64_t h = 0xcbf29ce484222325ull ^
+                     (seed * 0x9E3779B97F4A7C15ull);
+        for( char c : s ) {
+            h ^= uint64_t( (unsigned char)c );
+            h *= 0x100000001b3ull;
+        }
+        return h ^ (h >> 29);
+    }
+
+    static constexpr size_t num_slots() {
+        size_t size = 1;
+        while( size < 4*N ) size *= 2;
+        return size;
+    }
+
+    static constexpr uint32_t empty    = uint32_t( -1 );
+    static constexpr uint64_t max_seed = 1024;
+
+    std::array<value_type, N>           m_data;
+    // Indices into m_data sorted by value.
+    std::array<uint32_t, N>             m_by_val;
+    // Perfect hash table of indices into m_data; only valid when
+    // m_seed < max_seed.
+    std::array<uint32_t, num_slots()>   m_slots;
+    uint64_t                            m_seed;
+    // True if the values are exactly 0..N-1.
+    bool                                m_dense;
+};
+
+template<typename ValT, size_t N>
+constexpr StaticBiMap<ValT, N>::StaticBiMap(
+        value_type const (&data)[N] )
+    : m_data(), m_by_val(), m_slots(), m_seed( 0 ),
+      m_dense( true ) {
+
+    // Insertion sort since std::sort is not constexpr in C++17.
+    for( size_t i = 0; i < N; ++i ) {
+        value_type e = data[i];
+        size_t j = i;
+        for( ; j > 0 && e.key < m_data[j-1].key; --j )
+            m_data[j] = m_data[j-1];
+        m_data[j] = e;
+    }
+    for( size_t i = 0; i < N; ++i ) {
+        uint32_t idx = uint32_t( i );
+        size_t j = i;
+        for( ; j > 0 && ord( m_data[idx].val ) <
+                        ord( m_data[m_by_val[j-1]].val ); --j )
+            m_by_val[j] = m_by_val[j-1];
+        m_by_val[j] = idx;
+    }
+    for( size_t i = 1; i < N; ++i ) {
+        if( m_data[i].key == m_data[i-1].key )
+            throw std::logic_error( "duplicate key in StaticBiMap" );
+        if( ord( m_data[m_by_val[i]].val ) ==
+            ord( m_data[m_by_val[i-1]].val ) )
+            throw std::logic_error( "duplicate val in StaticBiMap" );
+    }
+    for( size_t i = 0; i < N; ++i )
+        if( ord( m_data[m_by_val[i]].val ) !=
+            static_cast<decltype( ord( m_data[0].val ) )>( i ) )
+            m_dense = false;
+
+    // Find a seed for which no two keys land in the same slot.
+    for( ; m_seed < max_seed; ++m_seed ) {
+        for( auto& s : m_slots ) s = empty;
+        bool ok = true;
+        for( size_t i = 0; ok && i < N; ++i ) {
+            auto& s = m_slots[hash( m_data[i].key, m_seed ) &
+                              (num_slots()-1)];
+            ok = (s == empty);
+            s  = uint32_t( i );
+        }
+        if( ok ) break;
+    }
+}
+
+template<typename ValT, size_t N>
+constexpr std::optional<ValT>
+StaticBiMap<ValT, N>::val_safe( std::string_view key ) const {
+
+    if( m_seed < max_seed ) {
+        uint32_t idx = m_slots[hash( key, m_seed ) &
+                               (num_slots()-1)];
+        if( idx != empty && m_data[idx].key == key )
+            return m_data[idx].val;
+        return std::nullopt;
+    }
+    size_t lo = 0, hi = N;
+    while( lo < hi ) {
+        size_t mid = lo + (hi-lo)/2;
+        if( m_data[mid].key < key ) lo = mid+1;
+        else                        hi = mid;
+    }
+    if( lo < N && m_data[lo].key == key )
+        return m_data[lo].val;
+    return std::nullopt;
+}
+
+template<typename ValT, size_t N>
+constexpr std::optional<std::string_view>
+StaticBiMap<ValT, N>::key_safe( ValT val ) const {
+
+    if( m_dense ) {
+        // Negative values wrap around to large ones here.
+        auto o = static_cast<std::make_unsigned_t<
+                     decltype( ord( val ) )>>( ord( val ) );
+        if( o < N )
+            return m_data[m_by_val[o]].key;
+        return std::nullopt;
+    }
+    size_t lo = 0, hi = N;
+    while( lo < hi ) {
+        size_t mid = lo + (hi-lo)/2;
+        if( ord( m_data[m_by_val[mid]].val ) < ord( val ) )
+            lo = mid+1;
+        else
+            hi = mid;
+    }
+    if( lo < N && ord( m_data[m_by_val[lo]].val ) == ord( val ) )
+        return m_data[m_by_val[lo]].key;
+    return std::nullopt;
+}
+
+template<typename ValT, size_t N>
+ValT StaticBiMap<ValT, N>::val( std::string_view key ) const {
+    auto v = val_safe( key );
+    ASSERT( v, "key " << key << " not found in StaticBiMap" );
+    return *v;
+}
+
+template<typename ValT, size_t N>
+std::string_view StaticBiMap<ValT, N>::key( ValT val ) const {
+    auto k = key_safe( val );
+    ASSERT( k, "value not found in StaticBiMap" );
+    return *k;
+}
+
 } // namespace util
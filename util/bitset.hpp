@@ -0,0 +1,75 @@
+/****************************************************************
+* Dynamically sized bit set
+****************************************************************/
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace util {
+
+// Index of the lowest set bit; w must not be zero.
+inline int ctz64( uint64_t w ) {
+#ifdef __GNUC__
+    return __builtin_ctzll( w );
+#else
+    int n = 0;
+    for( ; !(w & 1); w >>= 1 ) ++n;
+    return n;
+#endif
+}
+
+/****************************************************************
+* DynBitset
+*
+* A  fixed-after-resize  set  of bits packed 64 to a word. Unlike
+* vector<bool> the words are exposed so that callers can operate on
+* many bits at once (e.g. for clearing or scanning).
+****************************************************************/
+class DynBitset {
+
+public:
+    using word_type = uint64_t;
+
+    static constexpr size_t word_bits = 64;
+
+    DynBitset() : m_words(), m_size( 0 ) {}
+    explicit DynBitset( size_t n ) : DynBitset() { resize( n ); }
+
+    // New bits (if any) are cleared.
+    void resize( size_t n ) {
+        m_words.resize( (n + word_bits - 1) / word_bits, 0 );
+        m_size = n;
+    }
+
+    size_t size() const { return m_size; }
+
+    bool test( size_t i ) const
+        { return (m_words[i/word_bits] >> (i%word_bits)) & 1; }
+
+    void set( size_t i )
+        { m_words[i/word_bits] |=  (word_type( 1 ) << (i%word_bits)); }
+    void reset( size_t i )
+        { m_words[i/word_bits] &= ~(word_type( 1 ) << (i%word_bits)); }
+
+    // Sets the bit and returns its previous value.
+    bool test_and_set( size_t i ) {
+        word_type& w   = m_words[i/word_bits];
+        word_type  bit = word_type( 1 ) << (i%word_bits);
+        bool       old = (w & bit) != 0;
+        w |= bit;
+        return old;
+    }
+
+    // Clears all bits.
+    void clear() { m_words.assign( m_words.size(), 0 ); }
+
+    std::vector<word_type>&       words()       { return m_words; }
+    std::vector<word_type> const& words() const { return m_words; }
+
+private:
+    std::vector<word_type> m_words;
+    size_t                 m_size;
+};
+
+} // namespace util
@@ -334,12 +334,11 @@ bool path_equals( fs::path const& a,
         return (a_n == b_n);
 
     // Now we must do a case-insensitive comparison.  The  string
-    // type used by fs::path could  vary by platform, so whenever
-    // we convert path to string we need to do it like so.
-    using String = fs::path::string_type;
-
+    // type used by fs::path could  vary by platform, so we compare
+    // the native strings, which avoids copying  them  and  which
+    // will  select  the  ASCII fast path for char strings.
     auto predicate = []( auto const& p1, auto const& p2) {
-        return iequals( String( p1 ), String( p2 ) );
+        return iequals( p1.native(), p2.native() );
     };
 
     // This will iterate through path components and compare each
@@ -0,0 +1,213 @@
+/****************************************************************
+* Binary serialization of graphs
+****************************************************************/
+#include "graph-io.hpp"
+#include "macros.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace std;
+
+namespace util {
+
+namespace {
+
+constexpr char     graph_magic[8]   = { 'C','P','P','G','R','A','P','H' };
+constexpr uint32_t graph_version    = 1;
+constexpr uint32_t graph_byte_order = 0x01020304;
+
+struct GraphFileHeader {
+    char     magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint64_t num_nodes;
+    uint64_t num_edges;
+    uint64_t blob_bytes;
+    uint64_t checksum;
+};
+
+static_assert( sizeof( GraphFileHeader ) % 8 == 0 );
+
+size_t align8( size_t n ) { return (n + 7) & ~size_t( 7 ); }
+
+// Positions of the sections in the file, which follow from the
+// counts in the header.
+struct GraphFileLayout {
+    explicit GraphFileLayout( GraphFileHeader const& h )
+        : offsets( sizeof( GraphFileHeader ) ),
+          targets( offsets + align8( (h.num_nodes+1)*sizeof( uint32_t ) ) ),
+          name_offsets( targets + align8( h.num_edges*sizeof( uint32_t ) ) ),
+          blob( name_offsets + (h.num_nodes+1)*sizeof( uint64_t ) ),
+          total( blob + align8( h.blob_bytes ) ) {}
+
+    size_t offsets, targets, name_offsets, blob, total;
+};
+
+// Word-at-a-time FNV-1a; n must be a multiple of eight,  which  it
+// is for everything after the header since all sections are pad-
+// ded to eight bytes.
+uint64_t checksum( char const* p, size_t n ) {
+    constexpr uint64_t prime = 0x100000001b3ULL;
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for( size_t i = 0; i < n; i += sizeof( uint64_t ) ) {
+        uint64_t w;
+        memcpy( &w, p+i, sizeof( w ) );
+        h = (h ^ w) * prime;
+    }
+    return h;
+}
+
+} // anonymous namespace
+
+void write_graph( fs::path const&             p,
+                  CsrView                     g,
+                  vector<string_view> const& names ) {
+    ASSERT( names.size() == g.num_nodes, "graph has " <<
+            g.num_nodes << " nodes but " << names.size() <<
+            " names were given" );
+    ASSERT( adjacent_find( names.begin(), names.end(),
+                [](auto l, auto r){ return !(l < r); } ) == names.end(),
+            "names of graph nodes must be sorted and unique" );
+
+    GraphFileHeader h{};
+    memcpy( h.magic, graph_magic, sizeof( h.magic ) );
+    h.version    = graph_version;
+    h.byte_order = graph_byte_order;
+    h.num_nodes  = g.num_nodes;
+    h.num_edges  = g.num_edges();
+    h.blob_bytes = 0;
+    for( auto n : names ) h.blob_bytes += n.size();
+
+    GraphFileLayout l( h );
+    // Zero-initialized, so that the padding is deterministic.
+    vector<char> buf( l.total, 0 );
+
+    if( g.num_nodes > 0 ) {
+        memcpy( &buf[l.offsets], g.offsets,
+                (g.num_nodes+1)*sizeof( uint32_t ) );
+        memcpy( &buf[l.targets], g.targets,
+                h.num_edges*sizeof( uint32_t ) );
+    } else {
+        // An empty CsrView may not have an offsets array at all.
+        uint32_t zero = 0;
+        memcpy( &buf[l.offsets], &zero, sizeof( zero ) );
+    }
+
+    uint64_t pos = 0;
+    memcpy( &buf[l.name_offsets], &pos, sizeof( pos ) );
+    for( size_t i = 0; i < names.size(); ++i ) {
+        memcpy( &buf[l.blob+pos], names[i].data(), names[i].size() );
+        pos += names[i].size();
+        memcpy( &buf[l.name_offsets+(i+1)*sizeof( pos )], &pos,
+                sizeof( pos ) );
+    }
+
+    h.checksum = checksum( &buf[l.offsets], l.total-l.offsets );
+    memcpy( buf.data(), &h, sizeof( h ) );
+    write_file( p, buf );
+}
+
+void write_graph( fs::path const&                p,
+                  DirectedGraph<string> const& g ) {
+    vector<string_view> names;
+    names.reserve( g.size() );
+    for( size_t i = 0; i < g.size(); ++i )
+        names.push_back( g.name( i ) );
+    write_graph( p, g.csr().view(), names );
+}
+
+MappedGraph::MappedGraph( fs::path const& p, bool verify )
+    : m_file( p ),
+      m_view(),
+      m_name_offsets( nullptr ),
+      m_blob( nullptr ) {
+
+    GraphFileHeader h;
+    ASSERT( m_file.size() >= sizeof( h ), p << " is not a graph "
+            "file (too small)" );
+    memcpy( &h, m_file.data(), sizeof( h ) );
+    ASSERT( memcmp( h.magic, graph_magic, sizeof( h.magic ) ) == 0,
+            p << " is not a graph file" );
+    ASSERT( h.version == graph_version, "graph file " << p <<
+            " has version " << h.version << " but expected " <<
+            graph_version );
+    ASSERT( h.byte_order == graph_byte_order, "graph file " << p <<
+            " was written on a machine with a different byte order" );
+    // Guard against overflow in computing the layout from a  cor-
+    // rupted header; no section can be bigger than the file.
+    ASSERT( h.num_nodes < m_file.size() && h.num_edges < m_file.size()
+         && h.blob_bytes < m_file.size(), "graph file " << p <<
+            " has a corrupted header" );
+    GraphFileLayout l( h );
+    ASSERT( l.total == m_file.size(), "graph file " << p << " has "
+            "size " << m_file.size() << " but expected " << l.total );
+
+    // All sections are eight byte aligned relative to the  start
+    // of the file, and the start of the mapping is page aligned.
+    char const* base = m_file.data();
+    m_view.offsets   = reinterpret_cast<uint32_t const*>( base+l.offsets );
+    m_view.targets   = reinterpret_cast<Id const*>( base+l.targets );
+    m_view.num_nodes = h.num_nodes;
+    m_name_offsets   = reinterpret_cast<uint64_t const*>(
+                           base+l.name_offsets );
+    m_blob           = base+l.blob;
+
+    // Cheap checks of the ends of the arrays.
+    ASSERT( m_view.offsets[0] == 0 &&
+            m_view.offsets[h.num_nodes] == h.num_edges &&
+            m_name_offsets[0] == 0 &&
+            m_name_offsets[h.num_nodes] == h.blob_bytes,
+            "graph file " << p << " is corrupted" );
+
+    if( !verify )
+        return;
+
+    ASSERT( checksum( base+l.offsets, l.total-l.offsets ) ==
+            h.checksum, "graph file " << p << " has a bad checksum" );
+    for( size_t n = 0; n < h.num_nodes; ++n )
+        ASSERT( m_view.offsets[n] <= m_view.offsets[n+1] &&
+                m_name_offsets[n] <= m_name_offsets[n+1],
+                "graph file " << p << " is corrupted" );
+    for( size_t e = 0; e < h.num_edges; ++e )
+        ASSERT( m_view.targets[e] < h.num_nodes, "graph file " <<
+                p << " has an edge to a nonexistent node" );
+}
+
+string_view MappedGraph::name( Id id ) const {
+    ASSERT( id < size(), "node id " << id << " out of range" );
+    return string_view( m_blob + m_name_offsets[id],
+                        m_name_offsets[id+1] - m_name_offsets[id] );
+}
+
+optional<MappedGraph::Id> MappedGraph::id( string_view name ) const {
+    size_t lo = 0, hi = size();
+    while( lo < hi ) {
+        size_t mid = lo + (hi-lo)/2;
+        if( this->name( Id( mid ) ) < name )
+            lo = mid+1;
+        else
+            hi = mid;
+    }
+    if( lo < size() && this->name( Id( lo ) ) == name )
+        return Id( lo );
+    return nullopt;
+}
+
+vector<string_view>
+MappedGraph::accessible( string_view name, bool with_self ) const {
+    vector<string_view> res;
+    auto start = id( name );
+    if( !start )
+        return res;
+
+    auto& ws = thread_workspace();
+    csr_reachable( m_view, *start, ws );
+    res.reserve( ws.result.size() );
+    for( Id i : ws.result )
+        if( i != *start || with_self )
+            res.push_back( this->name( i ) );
+    return res;
+}
+
+} // namespace util
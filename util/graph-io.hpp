@@ -0,0 +1,96 @@
+/****************************************************************
+* Binary serialization of graphs
+****************************************************************/
+#pragma once
+
+#include "fs.hpp"
+#include "graph.hpp"
+#include "io.hpp"
+#include "non-copyable.hpp"
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace util {
+
+/****************************************************************
+* Graph files
+*
+* A  graph  file  holds  a  CSR  graph  together  with  the sorted
+* names of its nodes, laid out so that it can be memory-mapped and
+* used  directly without any parsing or allocation. After a fixed
+* size header come four sections, each starting at an eight  byte
+* boundary:
+*
+*   1. offsets:      (num_nodes+1) x uint32 (as in CsrView).
+*   2. targets:      num_edges x uint32.
+*   3. name offsets: (num_nodes+1) x uint64; the name of node  n
+*                    is blob[name_offsets[n]..name_offsets[n+1]).
+*   4. blob:         the names, concatenated, in sorted order.
+*
+* The header holds a magic string, a format version, a  byte  order
+* marker, the counts (from which the position of each section fol-
+* lows), and a checksum of everything after the header.  Integers
+* are  stored  in  native  byte order, and a file written on a ma-
+* chine with the other byte order will be rejected rather than
+* converted.
+****************************************************************/
+
+// Writes the graph g whose node n is named names[n]. The names must
+// be sorted and unique (as they are in a DirectedGraph) since that
+// is what allows a loaded graph to look them up without an index.
+void write_graph( fs::path const&                      p,
+                  CsrView                              g,
+                  std::vector<std::string_view> const& names );
+
+void write_graph( fs::path const&                    p,
+                  DirectedGraph<std::string> const& g );
+
+/****************************************************************
+* MappedGraph
+*
+* A graph loaded from a graph file by memory-mapping it. Opening
+* only reads and checks the header (and that the file has the size
+* that it implies) and so takes the same time regardless  of  the
+* size  of  the  graph; the pages of the file are then brought in
+* by the OS as queries touch them.
+*
+* Without verify a corrupted file that has a valid header  could
+* cause  out-of-range reads during queries, so files that may not
+* have been written by write_graph should be opened with verify,
+* which checks the checksum as well as that all edges and names
+* are in range (taking time proportional to the file size).
+****************************************************************/
+class MappedGraph : util::movable_only {
+
+public:
+    using Id = CsrView::Id;
+
+    // Throws if the file is not a valid graph file.
+    explicit MappedGraph( fs::path const& p, bool verify = false );
+
+    // Number of nodes.
+    size_t size() const { return m_view.num_nodes; }
+
+    CsrView view() const { return m_view; }
+
+    std::string_view name( Id id ) const;
+
+    // Id of the node with the given name, found by binary search.
+    std::optional<Id> id( std::string_view name ) const;
+
+    // Same as DirectedGraph::accessible.
+    std::vector<std::string_view>
+    accessible( std::string_view name, bool with_self = true ) const;
+
+private:
+    MappedFile       m_file;
+    CsrView          m_view;
+    uint64_t const*  m_name_offsets;
+    char const*      m_blob;
+};
+
+} // namespace util
@@ -0,0 +1,583 @@
+/****************************************************************
+* Graphs
+****************************************************************/
+#include "graph.hpp"
+#include "algo-par.hpp"
+
+#include <algorithm>
+#include <atomic>
+
+using namespace std;
+
+namespace util {
+
+namespace {
+
+// Tuning  parameters  for  the  direction-optimizing  BFS: switch
+// to bottom-up when the edges out of the frontier exceed 1/alpha
+// of the unexplored edges, and back to top-down when the frontier
+// holds fewer than 1/beta of the nodes. These are the values  re-
+// commended by Beamer et al.
+constexpr size_t bfs_alpha = 14;
+constexpr size_t bfs_beta  = 24;
+
+// Work is handed out to the threads in chunks of this many fron-
+// tier nodes (top-down) or bitmap words (bottom-up).
+constexpr size_t bfs_node_chunk = 256;
+constexpr size_t bfs_word_chunk = 16;
+
+} // anonymous namespace
+
+CsrGraph::CsrGraph() : m_offsets( 1, 0 ), m_targets() {}
+
+CsrGraph::CsrGraph( vector<uint32_t>&& offsets,
+                    vector<Id>&&       targets )
+    : m_offsets( move( offsets ) ),
+      m_targets( move( targets ) ) {
+
+    ASSERT( !m_offsets.empty() && m_offsets[0] == 0,
+            "CSR offsets must start with zero" );
+    ASSERT( m_offsets.back() == m_targets.size(),
+            "CSR offsets do not match number of edges" );
+    ASSERT( is_sorted( m_offsets.begin(), m_offsets.end() ),
+            "CSR offsets must be non-decreasing" );
+    for( Id t : m_targets )
+        ASSERT( t < num_nodes(), "CSR edge target " << t <<
+                " is out of range" );
+}
+
+CsrGraph::CsrGraph( vector<vector<Id>> const& adj )
+    : m_offsets(), m_targets() {
+
+    m_offsets.reserve( adj.size()+1 );
+    m_offsets.push_back( 0 );
+    size_t total = 0;
+    for( auto const& v : adj )
+        total += v.size();
+    ASSERT( total < uint32_t( -1 ), "too many edges for CsrGraph" );
+    m_targets.reserve( total );
+    for( auto const& v : adj ) {
+        for( Id t : v ) {
+            ASSERT( t < adj.size(), "CSR edge target " << t <<
+                    " is out of range" );
+            m_targets.push_back( t );
+        }
+        m_offsets.push_back( uint32_t( m_targets.size() ) );
+    }
+}
+
+CsrView CsrGraph::view() const {
+    return { m_offsets.data(), m_targets.data(), num_nodes() };
+}
+
+CsrGraph CsrGraph::reversed() const {
+
+    // Counting sort of the edges by target.
+    size_t n = num_nodes();
+    vector<uint32_t> offsets( n+1, 0 );
+    for( Id t : m_targets )
+        ++offsets[t+1];
+    for( size_t i = 0; i < n; ++i )
+        offsets[i+1] += offsets[i];
+
+    vector<Id>       targets( m_targets.size() );
+    vector<uint32_t> pos( offsets.begin(), offsets.end()-1 );
+    for( Id s = 0; s < n; ++s )
+        for( uint32_t e = m_offsets[s]; e < m_offsets[s+1]; ++e )
+            targets[pos[m_targets[e]]++] = s;
+
+    CsrGraph res;
+    res.m_offsets = move( offsets );
+    res.m_targets = move( targets );
+    return res;
+}
+
+ReverseIndex::ReverseIndex() : m_once(), m_rev() {}
+
+CsrGraph const& ReverseIndex::get( CsrGraph const& fwd ) const {
+    call_once( m_once, [&]{ m_rev = fwd.reversed(); } );
+    return m_rev;
+}
+
+size_t CsrGraph::memory_bytes() const {
+    return m_offsets.capacity()*sizeof( uint32_t ) +
+           m_targets.capacity()*sizeof( Id );
+}
+
+void GraphWorkspace::prepare( size_t n ) {
+    if( visited.size() < n )
+        visited.resize( n );
+}
+
+GraphWorkspace& thread_workspace() {
+    thread_local GraphWorkspace ws;
+    return ws;
+}
+
+void csr_reachable( CsrView g, CsrView::Id start,
+                    GraphWorkspace& ws ) {
+
+    ws.prepare( g.num_nodes );
+    ws.result.clear();
+    ws.stack.clear();
+
+    // Nodes are marked as visited when they are pushed, not when
+    // they are popped, so that each is pushed at most once.
+    ws.visited.set( start );
+    ws.stack.push_back( start );
+    while( !ws.stack.empty() ) {
+        auto n = ws.stack.back(); ws.stack.pop_back();
+        ws.result.push_back( n );
+        for( auto t : g.edges( n ) )
+            if( !ws.visited.test_and_set( t ) )
+                ws.stack.push_back( t );
+    }
+
+    for( auto n : ws.result )
+        ws.visited.reset( n );
+}
+
+void csr_reachable_bounded( CsrView g, CsrView::Id start,
+                            SearchLimits limits,
+                            GraphWorkspace& ws ) {
+
+    ws.prepare( g.num_nodes );
+    ws.result.clear();
+    if( limits.max_count == 0 )
+        return;
+
+    // ws.result doubles as the queue; each pass of the outer loop
+    // expands one level.
+    auto& res = ws.result;
+    ws.visited.set( start );
+    res.push_back( start );
+    size_t level_begin = 0;
+    bool   full        = (res.size() == limits.max_count);
+    for( size_t depth = 0; !full && depth < limits.max_depth &&
+                           level_begin < res.size(); ++depth ) {
+        size_t level_end = res.size();
+        for( size_t i = level_begin; !full && i < level_end; ++i ) {
+            for( auto w : g.edges( res[i] ) ) {
+                if( ws.visited.test_and_set( w ) )
+                    continue;
+                res.push_back( w );
+                if( (full = (res.size() == limits.max_count)) )
+                    break;
+            }
+        }
+        level_begin = level_end;
+    }
+
+    for( auto n : res )
+        ws.visited.reset( n );
+}
+
+void csr_reachable_par( CsrView g,
+                        function<CsrView()> const& reverse,
+                        CsrView::Id start, int jobs_in,
+                        vector<CsrView::Id>& out,
+                        size_t serial_below ) {
+    using Id = CsrView::Id;
+
+    ASSERT_( jobs_in >= 0 );
+    size_t jobs = (jobs_in == 0) ? par::max_threads() : jobs_in;
+
+    if( jobs <= 1 || g.num_nodes < serial_below ) {
+        auto& ws = thread_workspace();
+        csr_reachable( g, start, ws );
+        out = ws.result;
+        return;
+    }
+
+    size_t const n         = g.num_nodes;
+    size_t const num_words = (n + 63) / 64;
+
+    unique_ptr<atomic<uint64_t>[]> visited(
+        new atomic<uint64_t>[num_words] );
+    for( size_t i = 0; i < num_words; ++i )
+        visited[i].store( 0, memory_order_relaxed );
+    visited[start/64].store( uint64_t( 1 ) << (start%64),
+                             memory_order_relaxed );
+
+    // State shared by the threads. It is only modified by the ba-
+    // rrier's completion function, while all threads are waiting.
+    vector<Id>         frontier{ start };
+    vector<uint64_t>   frontier_bits;
+    vector<vector<Id>> found( jobs );
+    atomic<size_t>     cursor{ 0 };
+    bool               bottom_up  = false;
+    bool               done       = false;
+    CsrView            rev;
+    size_t             edges_left = g.num_edges() -
+                                    g.edges( start ).size();
+
+    out.clear();
+    out.push_back( start );
+
+    auto try_visit = [&]( Id v ) {
+        uint64_t bit = uint64_t( 1 ) << (v%64);
+        auto&    w   = visited[v/64];
+        // Cheap check first to avoid the atomic RMW in the common
+        // case of the node already having been visited.
+        if( w.load( memory_order_relaxed ) & bit )
+            return false;
+        return !(w.fetch_or( bit, memory_order_relaxed ) & bit);
+    };
+
+    auto step_top_down = [&]( size_t t ) {
+        for( ;; ) {
+            size_t b = cursor.fetch_add( bfs_node_chunk );
+            if( b >= frontier.size() )
+                break;
+            size_t e = min( b + bfs_node_chunk, frontier.size() );
+            for( size_t i = b; i < e; ++i )
+                for( Id v : g.edges( frontier[i] ) )
+                    if( try_visit( v ) )
+                        found[t].push_back( v );
+        }
+    };
+
+    auto step_bottom_up = [&]( size_t t ) {
+        // Threads claim whole words, so each word of the visited
+        // bitmap is only written by one thread in this step.
+        for( ;; ) {
+            size_t b = cursor.fetch_add( bfs_word_chunk );
+            if( b >= num_words )
+                break;
+            size_t e = min( b + bfs_word_chunk, num_words );
+            for( size_t w = b; w < e; ++w ) {
+                uint64_t todo  = ~visited[w].load(
+                                    memory_order_relaxed );
+                uint64_t added = 0;
+                for( ; todo; todo &= todo-1 ) {
+                    int  bit = ctz64( todo );
+                    auto v   = Id( w*64 + bit );
+                    if( v >= n )
+                        break;
+                    for( Id u : rev.edges( v ) ) {
+                        if( (frontier_bits[u/64] >> (u%64)) & 1 ) {
+                            added |= uint64_t( 1 ) << bit;
+                            found[t].push_back( v );
+                            break;
+                        }
+                    }
+                }
+                if( added )
+                    visited[w].fetch_or( added,
+                                         memory_order_relaxed );
+            }
+        }
+    };
+
+    // Runs in one thread after all threads finish a level.
+    auto next_level = [&] {
+        frontier.clear();
+        size_t frontier_edges = 0;
+        for( auto& f : found ) {
+            for( Id v : f ) {
+                frontier.push_back( v );
+                frontier_edges += g.edges( v ).size();
+            }
+            f.clear();
+        }
+        out.insert( out.end(), frontier.begin(), frontier.end() );
+        edges_left -= frontier_edges;
+        cursor.store( 0 );
+
+        if( frontier.empty() ) {
+            done = true;
+            return;
+        }
+        if( !bottom_up && frontier_edges > edges_left/bfs_alpha )
+            bottom_up = true;
+        else if( bottom_up && frontier.size() < n/bfs_beta )
+            bottom_up = false;
+
+        if( bottom_up ) {
+            if( !rev.offsets )
+                rev = reverse();
+            frontier_bits.assign( num_words, 0 );
+            for( Id v : frontier )
+                frontier_bits[v/64] |= uint64_t( 1 ) << (v%64);
+        }
+    };
+
+    par::Barrier barrier( jobs, next_level );
+
+    auto worker = [&]( size_t t ) {
+        // `done` and `bottom_up` are only written while all  the
+        // threads are inside the barrier.
+        while( !done ) {
+            if( bottom_up ) step_bottom_up( t );
+            else            step_top_down( t );
+            barrier.arrive_and_wait();
+        }
+    };
+
+    vector<function<void()>> funcs( jobs );
+    for( size_t i = 0; i < jobs; ++i )
+        funcs[i] = [&worker, i]{ worker( i ); };
+    par::in_parallel( funcs );
+}
+
+// Tarjan's algorithm, made iterative (with an explicit stack of
+// (node, next edge) frames) so that deep graphs can't overflow the
+// call stack.
+Sccs csr_sccs( CsrView g ) {
+    using Id = CsrView::Id;
+    constexpr uint32_t unvisited = uint32_t( -1 );
+
+    size_t const n = g.num_nodes;
+    Sccs res;
+    res.comp.assign( n, unvisited );
+    vector<uint32_t> index( n, unvisited ), low( n );
+    DynBitset        on_stack( n );
+    vector<Id>       stack;
+    vector<pair<Id, uint32_t>> frames;
+    uint32_t         next_index = 0;
+
+    auto enter = [&]( Id v ) {
+        index[v] = low[v] = next_index++;
+        stack.push_back( v );
+        on_stack.set( v );
+        frames.emplace_back( v, g.offsets[v] );
+    };
+
+    for( Id s = 0; s < n; ++s ) {
+        if( index[s] != unvisited )
+            continue;
+        enter( s );
+        while( !frames.empty() ) {
+            auto& [v, e] = frames.back();
+            if( e < g.offsets[v+1] ) {
+                Id w = g.targets[e++];
+                if( index[w] == unvisited )
+                    enter( w ); // invalidates v and e
+                else if( on_stack.test( w ) )
+                    low[v] = min( low[v], index[w] );
+                continue;
+            }
+            Id done = v;
+            frames.pop_back();
+            if( low[done] == index[done] ) {
+                Id w;
+                do {
+                    w = stack.back(); stack.pop_back();
+                    on_stack.reset( w );
+                    res.comp[w] = res.count;
+                } while( w != done );
+                ++res.count;
+            }
+            if( !frames.empty() ) {
+                Id parent = frames.back().first;
+                low[parent] = min( low[parent], low[done] );
+            }
+        }
+    }
+    return res;
+}
+
+CsrGraph csr_condense( CsrView g, Sccs const& sccs ) {
+    using Id = CsrView::Id;
+
+    // Group the nodes by component.
+    vector<uint32_t> first( sccs.count+1, 0 );
+    for( auto c : sccs.comp ) ++first[c+1];
+    for( size_t c = 0; c < sccs.count; ++c ) first[c+1] += first[c];
+    vector<Id>       members( g.num_nodes );
+    vector<uint32_t> pos( first.begin(), first.end()-1 );
+    for( Id v = 0; v < g.num_nodes; ++v )
+        members[pos[sccs.comp[v]]++] = v;
+
+    vector<uint32_t> offsets{ 0 };
+    vector<Id>       targets;
+    offsets.reserve( sccs.count+1 );
+    for( uint32_t c = 0; c < sccs.count; ++c ) {
+        size_t begin = targets.size();
+        for( uint32_t i = first[c]; i < first[c+1]; ++i )
+            for( Id w : g.edges( members[i] ) )
+                if( sccs.comp[w] != c )
+                    targets.push_back( sccs.comp[w] );
+        sort( targets.begin()+begin, targets.end() );
+        targets.erase( unique( targets.begin()+begin,
+                               targets.end() ), targets.end() );
+        offsets.push_back( uint32_t( targets.size() ) );
+    }
+    return CsrGraph( move( offsets ), move( targets ) );
+}
+
+optional<vector<CsrView::Id>> csr_topo_sort( CsrView g ) {
+    using Id = CsrView::Id;
+
+    // Kahn's algorithm: repeatedly emit a node with no remaining
+    // incoming edges.
+    vector<uint32_t> in_degree( g.num_nodes, 0 );
+    for( size_t e = 0; e < g.num_edges(); ++e )
+        ++in_degree[g.targets[e]];
+
+    vector<Id> res; res.reserve( g.num_nodes );
+    for( Id v = 0; v < g.num_nodes; ++v )
+        if( in_degree[v] == 0 )
+            res.push_back( v );
+    // res doubles as the queue of nodes to process.
+    for( size_t i = 0; i < res.size(); ++i )
+        for( Id w : g.edges( res[i] ) )
+            if( --in_degree[w] == 0 )
+                res.push_back( w );
+
+    // Nodes on or after a cycle never reach zero.
+    if( res.size() != g.num_nodes )
+        return nullopt;
+    return res;
+}
+
+vector<vector<CsrView::Id>> csr_levels( CsrView g ) {
+    using Id = CsrView::Id;
+
+    auto sccs = csr_sccs( g );
+    auto dag  = csr_condense( g, sccs );
+    auto dv   = dag.view();
+
+    // Decreasing component number is a topological order, so each
+    // component's level is final before its edges are followed.
+    vector<uint32_t> level( sccs.count, 0 );
+    uint32_t         num_levels = 0;
+    for( uint32_t c = sccs.count; c-- > 0; ) {
+        num_levels = max( num_levels, level[c]+1 );
+        for( uint32_t d : dv.edges( c ) )
+            level[d] = max( level[d], level[c]+1 );
+    }
+
+    vector<vector<Id>> res( num_levels );
+    for( Id v = 0; v < g.num_nodes; ++v )
+        res[level[sccs.comp[v]]].push_back( v );
+    return res;
+}
+
+void csr_reachable_multi( CsrView g, vector<CsrView::Id> const& starts,
+                          vector<uint64_t>& reach,
+                          GraphWorkspace& ws ) {
+    using Id = CsrView::Id;
+
+    ASSERT( starts.size() <= 64, "at most 64 sources allowed" );
+    ws.prepare( g.num_nodes );
+    reach.assign( g.num_nodes, 0 );
+
+    // ws.visited marks the nodes currently in the work stack.
+    auto& todo = ws.stack;
+    todo.clear();
+    for( size_t i = 0; i < starts.size(); ++i ) {
+        reach[starts[i]] |= uint64_t( 1 ) << i;
+        if( !ws.visited.test_and_set( starts[i] ) )
+            todo.push_back( starts[i] );
+    }
+    while( !todo.empty() ) {
+        Id v = todo.back(); todo.pop_back();
+        ws.visited.reset( v );
+        uint64_t from = reach[v];
+        for( Id w : g.edges( v ) ) {
+            uint64_t added = from & ~reach[w];
+            if( !added )
+                continue;
+            reach[w] |= added;
+            if( !ws.visited.test_and_set( w ) )
+                todo.push_back( w );
+        }
+    }
+}
+
+ClosureIndex::ClosureIndex( CsrView g )
+    : m_comp(), m_post(), m_offsets(), m_intervals() {
+
+    auto sccs = csr_sccs( g );
+    auto dag  = csr_condense( g, sccs );
+    auto dv   = dag.view();
+    uint32_t const nc = sccs.count;
+    m_comp = move( sccs.comp );
+
+    // Number a spanning forest of the DAG in postorder. Visiting
+    // the roots in topological order (decreasing component num-
+    // ber) means every tree is rooted at a source. The interval of
+    // a component's subtree is [counter on entry, its own number].
+    constexpr uint32_t unvisited = uint32_t( -1 );
+    m_post.assign( nc, unvisited );
+    vector<uint32_t> low( nc );
+    vector<pair<uint32_t, uint32_t>> frames;
+    uint32_t counter = 0;
+    for( uint32_t r = nc; r-- > 0; ) {
+        if( m_post[r] != unvisited )
+            continue;
+        // Mark on entry (with a placeholder) so that nodes are not
+        // entered twice.
+        m_post[r] = unvisited-1;
+        low[r]    = counter;
+        frames.emplace_back( r, dv.offsets[r] );
+        while( !frames.empty() ) {
+            auto& [c, e] = frames.back();
+            if( e < dv.offsets[c+1] ) {
+                uint32_t d = dv.targets[e++];
+                if( m_post[d] == unvisited ) {
+                    m_post[d] = unvisited-1;
+                    low[d]    = counter;
+                    frames.emplace_back( d, dv.offsets[d] );
+                }
+                continue;
+            }
+            m_post[c] = counter++;
+            frames.pop_back();
+        }
+    }
+
+    // Since edges go from higher to lower component numbers, pro-
+    // cessing in increasing order means that all the components
+    // reachable from c have been labeled before c.
+    m_offsets.reserve( nc+1 );
+    m_offsets.push_back( 0 );
+    vector<Interval> tmp;
+    for( uint32_t c = 0; c < nc; ++c ) {
+        tmp.clear();
+        tmp.emplace_back( low[c], m_post[c] );
+        for( uint32_t d : dv.edges( c ) )
+            tmp.insert( tmp.end(),
+                        m_intervals.begin() + m_offsets[d],
+                        m_intervals.begin() + m_offsets[d+1] );
+        sort( tmp.begin(), tmp.end() );
+        // Merge overlapping and adjacent intervals.
+        size_t out = 0;
+        for( size_t i = 1; i < tmp.size(); ++i ) {
+            if( tmp[i].first <= tmp[out].second + 1 )
+                tmp[out].second = max( tmp[out].second,
+                                       tmp[i].second );
+            else
+                tmp[++out] = tmp[i];
+        }
+        tmp.resize( out+1 );
+        m_intervals.insert( m_intervals.end(), tmp.begin(),
+                            tmp.end() );
+        ASSERT( m_intervals.size() < uint32_t( -1 ),
+                "closure index is too large" );
+        m_offsets.push_back( uint32_t( m_intervals.size() ) );
+    }
+}
+
+bool ClosureIndex::reachable( CsrView::Id from,
+                              CsrView::Id to ) const {
+    uint32_t a = m_comp[from], b = m_comp[to];
+    if( a == b )
+        return true;
+    uint32_t x = m_post[b];
+    auto first = m_intervals.begin() + m_offsets[a];
+    auto last  = m_intervals.begin() + m_offsets[a+1];
+    // Find the last interval starting at or before x.
+    auto it = upper_bound( first, last, x,
+        []( uint32_t v, Interval const& i ) { return v < i.first; } );
+    return it != first && prev( it )->second >= x;
+}
+
+size_t ClosureIndex::memory_bytes() const {
+    return ( m_comp.capacity() + m_post.capacity() +
+             m_offsets.capacity() ) * sizeof( uint32_t ) +
+           m_intervals.capacity() * sizeof( Interval );
+}
+
+} // namespace util
@@ -6,22 +6,273 @@
 #include "macros.hpp"
 #include "non-copyable.hpp"
 #include "bimap.hpp"
+#include "bitset.hpp"
 #include "util.hpp"
 
+#include <cstdint>
+#include <functional>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
 #include <unordered_map>
 #include <vector>
 
 namespace util {
 
+/****************************************************************
+* Compressed Sparse Row (CSR) storage
+*
+* The  edges  of  a  graph  with  N  nodes (numbered 0..N-1) held
+* in  two  flat  arrays:  the  targets of all edges, grouped by
+* source node, and  N+1  offsets  such  that  the  edges  of node n
+* are  targets[offsets[n]..offsets[n+1]).  Compared  to  a vector
+* of vectors this needs no allocation per node, uses four bytes
+* per  edge, and keeps the edges of consecutive nodes contiguous
+* in memory.
+*
+* CsrView  is  a  non-owning  view  of  the  two  arrays, which is
+* what the traversal functions operate on, so  that  they  don't
+* care where the arrays live; CsrGraph owns them.
+****************************************************************/
+struct CsrView {
+
+    using Id = uint32_t;
+
+    struct Edges {
+        Id const* first;
+        Id const* last;
+
+        Id const* begin() const { return first; }
+        Id const* end()   const { return last;  }
+        size_t    size()  const { return size_t( last-first ); }
+        bool      empty() const { return first == last; }
+    };
+
+    size_t num_edges() const
+        { return num_nodes ? offsets[num_nodes] : 0; }
+
+    Edges edges( Id n ) const {
+        return { targets + offsets[n], targets + offsets[n+1] };
+    }
+
+    uint32_t const* offsets   = nullptr;
+    Id       const* targets   = nullptr;
+    size_t          num_nodes = 0;
+};
+
+class CsrGraph {
+
+public:
+    using Id = CsrView::Id;
+
+    CsrGraph();
+
+    // Will validate the arrays and throw if they are inconsistent.
+    CsrGraph( std::vector<uint32_t>&& offsets,
+              std::vector<Id>&&       targets );
+
+    // Builds from a list of the edges of each node.
+    explicit CsrGraph( std::vector<std::vector<Id>> const& adj );
+
+    size_t num_nodes() const { return m_offsets.size()-1; }
+    size_t num_edges() const { return m_targets.size(); }
+
+    CsrView view() const;
+
+    // The same nodes with the direction of every edge reversed.
+    CsrGraph reversed() const;
+
+    // Number of bytes of heap memory used by the arrays.
+    size_t memory_bytes() const;
+
+    std::vector<uint32_t> const& offsets() const { return m_offsets; }
+    std::vector<Id>       const& targets() const { return m_targets; }
+
+private:
+    std::vector<uint32_t> m_offsets;
+    std::vector<Id>       m_targets;
+};
+
+// The  reverse  of  a  graph, built the first time it is needed.
+// Safe to call get() from multiple threads at once.
+class ReverseIndex : util::non_copy_non_move {
+
+public:
+    ReverseIndex();
+
+    // Must always be called with the same graph.
+    CsrGraph const& get( CsrGraph const& fwd ) const;
+
+private:
+    mutable std::once_flag m_once;
+    mutable CsrGraph       m_rev;
+};
+
+/****************************************************************
+* Traversal
+****************************************************************/
+// Scratch memory for traversals, kept around between  them  so
+// that repeated queries don't allocate. The visited set is left
+// all clear after each traversal (it is cleared by walking the
+// result rather than the whole set, so the cost of a traversal
+// is proportional to what it visits, not to the graph size).
+struct GraphWorkspace {
+
+    // Makes sure the workspace is large enough for a graph with
+    // n nodes.
+    void prepare( size_t n );
+
+    DynBitset                visited;
+    std::vector<CsrView::Id> stack;
+    std::vector<CsrView::Id> result;
+};
+
+// A workspace that belongs to the calling thread.
+GraphWorkspace& thread_workspace();
+
+// Fills ws.result with all nodes reachable from start (including
+// start itself) in unspecified order.
+void csr_reachable( CsrView g, CsrView::Id start,
+                    GraphWorkspace& ws );
+
+// Limits on a search; nodes beyond them are not visited.
+struct SearchLimits {
+    // Maximum number of edges from the start node.
+    size_t max_depth = size_t( -1 );
+    // Maximum number of nodes found (including the start).
+    size_t max_count = size_t( -1 );
+};
+
+// Breadth-first version of csr_reachable that stops at the given
+// limits; ws.result is filled in order of increasing distance.
+void csr_reachable_bounded( CsrView g, CsrView::Id start,
+                            SearchLimits limits,
+                            GraphWorkspace& ws );
+
+// Graphs with fewer nodes than this are always searched serially
+// by csr_reachable_par since the threads would cost more than they
+// save.
+constexpr size_t par_bfs_min_nodes = size_t( 1 ) << 15;
+
+// Same  result  as  csr_reachable  (though in a different order)
+// but  computed by a breadth-first search using multiple threads
+// (jobs == 0 means the maximum number). Each level is expanded
+// either top-down (threads claim chunks of the frontier and push
+// its unvisited neighbors) or bottom-up (threads claim ranges of
+// unvisited nodes and look for any parent in the frontier). The
+// latter is far cheaper once the frontier covers a large part of
+// the graph, and the search switches between the two based on how
+// many edges each would examine (Beamer et al.). The bottom-up
+// steps need the reverse graph, which is fetched from `reverse`
+// only if and when the first such step happens. Visited nodes are
+// tracked in an atomic bitmap.
+void csr_reachable_par( CsrView g,
+                        std::function<CsrView()> const& reverse,
+                        CsrView::Id start, int jobs,
+                        std::vector<CsrView::Id>& out,
+                        size_t serial_below = par_bfs_min_nodes );
+
+// Multi-source reachability: for up to 64 start nodes at  once,
+// sets reach[v] to the mask of the starts (bit i for starts[i])
+// from which v is reachable. Rather than one search per start,
+// sets of sources are propagated along the edges as 64-bit words,
+// so a node is revisited only when it gains new sources.
+void csr_reachable_multi( CsrView g,
+                          std::vector<CsrView::Id> const& starts,
+                          std::vector<uint64_t>& reach,
+                          GraphWorkspace& ws );
+
+/****************************************************************
+* Structure
+*
+* These all run in time linear in the size of the graph and none
+* of them recurse, so they are safe on arbitrarily deep graphs.
+****************************************************************/
+// Strongly connected components.  Components are numbered in  a
+// reverse  topological  order  of  the condensation: every edge
+// between two components goes from a higher number to a  lower
+// one.
+struct Sccs {
+    // Component of each node.
+    std::vector<uint32_t> comp;
+    uint32_t              count = 0;
+};
+
+Sccs csr_sccs( CsrView g );
+
+// The graph of the components (a DAG), where there is an edge from
+// one component to another if there is any edge between their
+// members. Has no duplicate edges or self loops.
+CsrGraph csr_condense( CsrView g, Sccs const& sccs );
+
+// An order of the nodes such that for every edge (u,v), u comes be-
+// fore v; nullopt if the graph has a cycle.
+std::optional<std::vector<CsrView::Id>> csr_topo_sort( CsrView g );
+
+// Partitions the nodes into levels such that every edge (u,v) goes
+// from  a lower level to a higher one, and each node is on the low-
+// est level that allows this; so level 0 holds the nodes with no in-
+// coming edges. Nodes within a level have no edges between them,
+// except that the members of a cycle are all put on the same level
+// (edges within a component are ignored).
+std::vector<std::vector<CsrView::Id>> csr_levels( CsrView g );
+
+/****************************************************************
+* ClosureIndex
+*
+* Precomputed transitive closure of a graph answering "is b reach-
+* able from a" without a traversal. Nodes in the same strongly
+* connected component reach each other, so the graph is first
+* condensed  into a DAG of components. A spanning forest of that
+* DAG is numbered in postorder, so that the components below any
+* given one in its tree form a contiguous interval of  numbers;
+* each  component  is  then  labeled with the (merged) intervals
+* of itself and everything it can reach (Agrawal et al., "Effici-
+* ent  Management  of Transitive Relationships"). A query is a
+* binary search in the intervals of the source's component.
+*
+* For  typical  dependency  graphs the number of intervals per
+* component is small, but it can reach O(N) in the worst case.
+****************************************************************/
+class ClosureIndex : util::movable_only {
+
+public:
+    explicit ClosureIndex( CsrView g );
+
+    bool reachable( CsrView::Id from, CsrView::Id to ) const;
+
+    size_t num_components() const { return m_post.size(); }
+
+    // Number of bytes of heap memory used by the index.
+    size_t memory_bytes() const;
+
+private:
+    using Interval = std::pair<uint32_t, uint32_t>;
+
+    // Component of each node.
+    std::vector<uint32_t> m_comp;
+    // Postorder number of each component.
+    std::vector<uint32_t> m_post;
+    // Intervals of each component in CSR form, sorted and dis-
+    // joint.
+    std::vector<uint32_t> m_offsets;
+    std::vector<Interval> m_intervals;
+};
+
 /****************************************************************
 * Directed Graph (not acyclic)
 ****************************************************************/
 
+template<typename NameT> class MutableGraph;
+
 template<typename NameT>
 class DirectedGraph : util::movable_only {
 
 public:
+    // So that it can produce snapshots without going through
+    // make_graph.
+    friend class MutableGraph<NameT>;
 
     template<
         typename NameT_,
@@ -43,32 +294,130 @@ public:
                const& m
     );
 
+    // Number of nodes.
+    size_t size() const { return m_names.size(); }
+
     // By default the node with the given name, if found, will be
     // included among the results,  unless  with_self == false in
-    // which case it will be left out.
+    // which case it will be left out. The order of the results is
+    // unspecified.
     std::vector<NameT> accessible( NameT const& name,
                                    bool with_self = true ) const;
 
+    // Same as above but with a caller-supplied workspace.
+    std::vector<NameT> accessible( NameT const&    name,
+                                   bool            with_self,
+                                   GraphWorkspace& ws ) const;
+
+    // Nodes from which the given one is accessible, i.e.,  acces-
+    // sible() following edges backwards.
+    std::vector<NameT> reverse_accessible( NameT const& name,
+                                           bool with_self = true
+                                         ) const;
+
+    // These return the nodes accessible within the given limits,
+    // in order of increasing distance from the given node. The
+    // count limit does not include the node itself when with_self
+    // is false.
+    std::vector<NameT> accessible_bounded(
+            NameT const& name, SearchLimits limits,
+            bool with_self = true ) const;
+    std::vector<NameT> reverse_accessible_bounded(
+            NameT const& name, SearchLimits limits,
+            bool with_self = true ) const;
+
+    // The reverse edges needed by the reverse_* queries and by
+    // accessible_par are normally built on first use; this builds
+    // them now instead.
+    void build_reverse_index() const { m_reverse->get( m_edges ); }
+
+    // Same results as accessible() (in a different order) but the
+    // search is spread over `jobs` threads, where zero means the
+    // maximum  number. Small graphs are searched serially.
+    std::vector<NameT> accessible_par( NameT const& name,
+                                       int          jobs = 0,
+                                       bool         with_self = true
+                                     ) const;
+
+    // Returns, for each of the given names, the same result that
+    // accessible() would, but with one traversal per 64 names.
+    std::vector<std::vector<NameT>> accessible_many(
+            std::vector<NameT> const& names,
+            bool                      with_self = true ) const;
+
+    // The closure index makes reachable() O(log) but has a  cost
+    // to build; it stays until dropped.
+    void build_closure();
+    void drop_closure() { m_closure.reset(); }
+    bool has_closure() const { return bool( m_closure ); }
+
+    // Is `to` accessible from `from`; false if either is not in
+    // the graph. Without a closure index this does a traversal.
+    bool reachable( NameT const& from, NameT const& to ) const;
+
+    // Strongly connected components (i.e., cycles, plus a compo-
+    // nent for each node not on any cycle), in the order de-
+    // scribed for csr_sccs.
+    std::vector<std::vector<NameT>> sccs() const;
+
+    struct Condensation {
+        // The members of each component.
+        std::vector<std::vector<NameT>> components;
+        // Edges between the components, as indices into the above.
+        CsrGraph                        dag;
+    };
+
+    Condensation condensation() const;
+
+    // nullopt if the graph has a cycle.
+    std::optional<std::vector<NameT>> topo_sort() const;
+
+    // See csr_levels. For a graph in which edges point from a node
+    // to  those  it  depends  on,  the  levels processed in reverse
+    // order give sets of nodes that can be processed concurrently.
+    std::vector<std::vector<NameT>> levels() const;
+
+    CsrGraph const& csr() const { return m_edges; }
+
+    // Name of the node with the given id in csr(); ids are  in  the
+    // sorted order of the names.
+    NameT const& name( size_t id ) const { return m_names.val( id ); }
+
 private:
 
     using NamesMap = BDIndexMap<NameT>;
-    using Id       = size_t;
-    using GraphVec = std::vector<std::vector<Id>>;
+    using Id       = CsrGraph::Id;
+
+    DirectedGraph( CsrGraph&& edges, NamesMap&& names );
 
-    DirectedGraph( GraphVec&& edges, NamesMap&& names );
+    CsrView reverse_view() const
+        { return m_reverse->get( m_edges ).view(); }
+
+    std::vector<NameT> bounded( CsrView g, NameT const& name,
+                                SearchLimits limits,
+                                bool with_self ) const;
+
+    // Converts ids found by a search to names.
+    std::vector<NameT> names_of( std::vector<Id> const& ids,
+                                 Id self, bool with_self ) const;
 
     NamesMap m_names;
-    GraphVec m_edges;
+    CsrGraph m_edges;
+    // Held by pointer so that the graph remains movable.
+    std::unique_ptr<ReverseIndex> m_reverse;
+    std::unique_ptr<ClosureIndex> m_closure;
 
 };
 
 template<typename NameT>
-DirectedGraph<NameT>::DirectedGraph( GraphVec&& edges,
+DirectedGraph<NameT>::DirectedGraph( CsrGraph&& edges,
                                      NamesMap&& names )
     : m_names( std::move( names ) ),
-      m_edges( std::move( edges ) )
+      m_edges( std::move( edges ) ),
+      m_reverse( std::make_unique<ReverseIndex>() ),
+      m_closure()
 {
-    ASSERT_( m_names.size() == m_edges.size() );
+    ASSERT_( m_names.size() == m_edges.num_nodes() );
 }
 
 template<
@@ -95,56 +444,242 @@ DirectedGraph<NameT> make_graph( MapT<
     // true == items are sorted, due to above.
     auto bm = BDIndexMap( std::move( names ), true );
 
-    typename DirectedGraph<NameT>::GraphVec edges;
-    edges.reserve( m.size() );
+    std::vector<uint32_t>     offsets; offsets.reserve( m.size()+1 );
+    std::vector<CsrGraph::Id> targets;
+    offsets.push_back( 0 );
 
     for( size_t i = 0; i < bm.size(); ++i ) {
         auto const& vs = util::get_val( m, bm.val( i ) );
-        std::vector<typename DirectedGraph<NameT>::Id> ids;
-        ids.reserve( vs.size() );
-        for( auto const& v : vs )
-            ids.push_back( bm.key( v ) );
-        edges.emplace_back( std::move( ids ) );
+        auto ids = bm.keys_of( vs );
+        targets.insert( std::end( targets ), std::begin( ids ),
+                        std::end( ids ) );
+        ASSERT( targets.size() < uint32_t( -1 ),
+                "too many edges for DirectedGraph" );
+        offsets.push_back( uint32_t( targets.size() ) );
     }
 
     return DirectedGraph(
-            std::move( edges ), std::move( bm ) );
+            CsrGraph( std::move( offsets ), std::move( targets ) ),
+            std::move( bm ) );
 }
 
 template<typename NameT>
 std::vector<NameT>
 DirectedGraph<NameT>::accessible( NameT const& name,
                                   bool with_self ) const {
+    return accessible( name, with_self, thread_workspace() );
+}
+
+template<typename NameT>
+std::vector<NameT>
+DirectedGraph<NameT>::accessible( NameT const&    name,
+                                  bool            with_self,
+                                  GraphWorkspace& ws ) const {
     std::vector<NameT> res;
-    std::vector<Id>    visited( m_names.size(), 0 );
-    std::vector<Id>    to_visit;
 
     auto start = m_names.key_safe( name );
-    Id self = -1; // invalid Id
-    if( start ) {
-        self = *start;
-        to_visit.push_back( self );
-    }
-     
-    while( !to_visit.empty() ) {
-        Id i = to_visit.back(); to_visit.pop_back();
-        if( visited[i] > 0 )
-            // We  may have duplicates in the stack if we include
-            // some  thing  a  second  time  before the first one
-            // (which is already in the stack) is visited.
+    if( !start )
+        return res;
+
+    csr_reachable( m_edges.view(), Id( *start ), ws );
+
+    return names_of( ws.result, Id( *start ), with_self );
+}
+
+// Same as make_graph above, but if mode is eager then the reverse
+// index is built up front rather than on first use.
+enum class ReverseIndexMode { lazy, eager };
+
+template<
+    typename NameT,
+    template<
+        typename Key,
+        typename Val,
+        typename...
+    >
+    typename MapT
+>
+DirectedGraph<NameT> make_graph( MapT<
+                                     NameT,
+                                     std::vector<NameT>
+                                 > const& m,
+                                 ReverseIndexMode mode ) {
+    auto g = make_graph( m );
+    if( mode == ReverseIndexMode::eager )
+        g.build_reverse_index();
+    return g;
+}
+
+template<typename NameT>
+std::vector<NameT>
+DirectedGraph<NameT>::reverse_accessible( NameT const& name,
+                                          bool with_self ) const {
+    auto start = m_names.key_safe( name );
+    if( !start )
+        return {};
+
+    auto& ws = thread_workspace();
+    csr_reachable( reverse_view(), Id( *start ), ws );
+    return names_of( ws.result, Id( *start ), with_self );
+}
+
+template<typename NameT>
+std::vector<NameT> DirectedGraph<NameT>::accessible_bounded(
+        NameT const& name, SearchLimits limits,
+        bool with_self ) const {
+    return bounded( m_edges.view(), name, limits, with_self );
+}
+
+template<typename NameT>
+std::vector<NameT> DirectedGraph<NameT>::reverse_accessible_bounded(
+        NameT const& name, SearchLimits limits,
+        bool with_self ) const {
+    auto start = m_names.key_safe( name );
+    if( !start )
+        return {};
+    return bounded( reverse_view(), name, limits, with_self );
+}
+
+template<typename NameT>
+std::vector<NameT> DirectedGraph<NameT>::bounded(
+        CsrView g, NameT const& name, SearchLimits limits,
+        bool with_self ) const {
+    auto start = m_names.key_safe( name );
+    if( !start || limits.max_count == 0 )
+        return {};
+
+    // The start node is always found first, so make room for it
+    // in the count if it is going to be dropped.
+    if( !with_self && limits.max_count != size_t( -1 ) )
+        ++limits.max_count;
+
+    auto& ws = thread_workspace();
+    csr_reachable_bounded( g, Id( *start ), limits, ws );
+    return names_of( ws.result, Id( *start ), with_self );
+}
+
+template<typename NameT>
+std::vector<NameT>
+DirectedGraph<NameT>::accessible_par( NameT const& name,
+                                      int          jobs,
+                                      bool         with_self ) const {
+    auto start = m_names.key_safe( name );
+    if( !start )
+        return {};
+
+    std::vector<Id> ids;
+    csr_reachable_par( m_edges.view(),
+        [this]{ return m_reverse->get( m_edges ).view(); },
+        Id( *start ), jobs, ids );
+
+    return names_of( ids, Id( *start ), with_self );
+}
+
+template<typename NameT>
+std::vector<std::vector<NameT>>
+DirectedGraph<NameT>::accessible_many(
+        std::vector<NameT> const& names, bool with_self ) const {
+
+    std::vector<std::vector<NameT>> res( names.size() );
+    auto&                 ws = thread_workspace();
+    std::vector<uint64_t> reach;
+    std::vector<Id>       starts;
+    // Index into `names` of each start in the current batch.
+    std::vector<size_t>   which;
+
+    for( size_t b = 0; b < names.size(); b += 64 ) {
+        starts.clear(); which.clear();
+        size_t e = std::min( b+64, names.size() );
+        for( size_t i = b; i < e; ++i ) {
+            if( auto id = m_names.key_safe( names[i] ); id ) {
+                starts.push_back( Id( *id ) );
+                which.push_back( i );
+            }
+        }
+        if( starts.empty() )
             continue;
-        visited[i] = 1;
-        auto name = m_names.val( i );
-        if( i != self || with_self )
-            // Always add nodes that are not  the  starting  node,
-            // and then only add the starting node  if  with_self
-            // is true (i.e., caller wants it added).
-            res.push_back( name );
-        for( Id i : m_edges[i] )
-            if( visited[i] == 0 )
-                to_visit.push_back( i );
+        csr_reachable_multi( m_edges.view(), starts, reach, ws );
+        for( Id v = 0; v < Id( reach.size() ); ++v ) {
+            for( uint64_t m = reach[v]; m; m &= m-1 ) {
+                int bit = ctz64( m );
+                if( v != starts[bit] || with_self )
+                    res[which[bit]].push_back( m_names.val( v ) );
+            }
+        }
     }
+    return res;
+}
 
+template<typename NameT>
+void DirectedGraph<NameT>::build_closure() {
+    m_closure = std::make_unique<ClosureIndex>( m_edges.view() );
+}
+
+template<typename NameT>
+bool DirectedGraph<NameT>::reachable( NameT const& from,
+                                      NameT const& to ) const {
+    auto a = m_names.key_safe( from );
+    auto b = m_names.key_safe( to   );
+    if( !a || !b )
+        return false;
+    if( m_closure )
+        return m_closure->reachable( Id( *a ), Id( *b ) );
+    auto& ws = thread_workspace();
+    csr_reachable( m_edges.view(), Id( *a ), ws );
+    return std::find( ws.result.begin(), ws.result.end(),
+                      Id( *b ) ) != ws.result.end();
+}
+
+template<typename NameT>
+std::vector<std::vector<NameT>> DirectedGraph<NameT>::sccs() const {
+    auto sccs = csr_sccs( m_edges.view() );
+    std::vector<std::vector<NameT>> res( sccs.count );
+    for( Id v = 0; v < Id( size() ); ++v )
+        res[sccs.comp[v]].push_back( m_names.val( v ) );
+    return res;
+}
+
+template<typename NameT>
+typename DirectedGraph<NameT>::Condensation
+DirectedGraph<NameT>::condensation() const {
+    auto sccs = csr_sccs( m_edges.view() );
+    Condensation res;
+    res.components.resize( sccs.count );
+    for( Id v = 0; v < Id( size() ); ++v )
+        res.components[sccs.comp[v]].push_back( m_names.val( v ) );
+    res.dag = csr_condense( m_edges.view(), sccs );
+    return res;
+}
+
+template<typename NameT>
+std::optional<std::vector<NameT>>
+DirectedGraph<NameT>::topo_sort() const {
+    auto order = csr_topo_sort( m_edges.view() );
+    if( !order )
+        return std::nullopt;
+    return names_of( *order, Id( -1 ), true );
+}
+
+template<typename NameT>
+std::vector<std::vector<NameT>> DirectedGraph<NameT>::levels() const {
+    std::vector<std::vector<NameT>> res;
+    for( auto const& level : csr_levels( m_edges.view() ) )
+        res.push_back( names_of( level, Id( -1 ), true ) );
+    return res;
+}
+
+template<typename NameT>
+std::vector<NameT>
+DirectedGraph<NameT>::names_of( std::vector<Id> const& ids,
+                                Id self, bool with_self ) const {
+    std::vector<NameT> res;
+    res.reserve( ids.size() );
+    for( Id i : ids )
+        // Always add nodes that are not  the  starting  node,
+        // and then only add the starting node  if  with_self
+        // is true (i.e., caller wants it added).
+        if( i != self || with_self )
+            res.push_back( m_names.val( i ) );
     return res;
 }
 
@@ -0,0 +1,97 @@
+/****************************************************************
+* String Interning
+****************************************************************/
+#include "interner.hpp"
+#include "macros.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+
+using namespace std;
+
+namespace util {
+
+ostream& operator<<( ostream& out, Atom a ) {
+    return (out << "Atom(" << a.id() << ")");
+}
+
+// Copies the string into the arena and returns a view of the copy.
+// Strings that are larger than a block get their own block.
+string_view Interner::Arena::store( string_view s ) {
+    if( s.size() > m_left ) {
+        size_t size = max( block_size, s.size() );
+        m_blocks.emplace_back( new char[size] );
+        m_cur  = m_blocks.back().get();
+        m_left = size;
+    }
+    char* dst = m_cur;
+    if( !s.empty() )
+        memcpy( dst, s.data(), s.size() );
+    m_cur  += s.size();
+    m_left -= s.size();
+    return string_view( dst, s.size() );
+}
+
+Interner::Interner() : m_shards() {}
+
+uint32_t Interner::shard_of( string_view s ) {
+    // Use the high bits of the hash since the low bits are used by
+    // the hash table within the shard to select a bucket.
+    auto h = hash<string_view>{}( s );
+    return uint32_t( h >> (sizeof( h )*8 - shard_bits) );
+}
+
+Atom Interner::intern( string_view s ) {
+    uint32_t shard_idx = shard_of( s );
+    auto& shard = m_shards[shard_idx];
+    {
+        // First try with the read lock, since in the common  case
+        // (repeated strings) the string will already be there.
+        shared_lock<shared_mutex> lock( shard.mutex );
+        if( auto it = shard.ids.find( s ); it != shard.ids.end() )
+            return Atom( (it->second << shard_bits) | shard_idx );
+    }
+    unique_lock<shared_mutex> lock( shard.mutex );
+    // Must check again since another thread may have  inserted
+    // the string between us releasing and acquiring the lock.
+    if( auto it = shard.ids.find( s ); it != shard.ids.end() )
+        return Atom( (it->second << shard_bits) | shard_idx );
+    ASSERT( shard.strs.size() < (size_t( 1 ) << (32-shard_bits))-1,
+            "too many strings in Interner" );
+    auto local  = uint32_t( shard.strs.size() );
+    auto stored = shard.arena.store( s );
+    shard.strs.push_back( stored );
+    shard.ids.emplace( stored, local );
+    return Atom( (local << shard_bits) | shard_idx );
+}
+
+optional<Atom> Interner::find( string_view s ) const {
+    uint32_t shard_idx = shard_of( s );
+    auto const& shard = m_shards[shard_idx];
+    shared_lock<shared_mutex> lock( shard.mutex );
+    if( auto it = shard.ids.find( s ); it != shard.ids.end() )
+        return Atom( (it->second << shard_bits) | shard_idx );
+    return nullopt;
+}
+
+string_view Interner::str( Atom a ) const {
+    ASSERT( a.valid(), "invalid atom" );
+    auto const& shard = m_shards[a.id() & shard_mask];
+    auto local = a.id() >> shard_bits;
+    shared_lock<shared_mutex> lock( shard.mutex );
+    ASSERT( local < shard.strs.size(),
+            a << " does not belong to this Interner" );
+    return shard.strs[local];
+}
+
+size_t Interner::size() const {
+    size_t res = 0;
+    for( auto const& shard : m_shards ) {
+        shared_lock<shared_mutex> lock( shard.mutex );
+        res += shard.strs.size();
+    }
+    return res;
+}
+
+} // namespace util
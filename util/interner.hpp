@@ -0,0 +1,136 @@
+/****************************************************************
+* String Interning
+****************************************************************/
+#pragma once
+
+#include "non-copyable.hpp"
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <shared_mutex>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace util {
+
+/****************************************************************
+* Atom
+*
+* A compact (32-bit) handle to a string that has been interned in
+* an Interner. Two atoms from the same Interner are equal if  and
+* only if their strings are equal, so comparing and hashing atoms
+* is O(1) regardless of the length of the strings.
+*
+* NOTE: atoms are ordered by their numeric id, which is NOT the le-
+* xicographic order of the strings that they refer to.  The order-
+* ing only exists so that atoms can be used as keys in sorted con-
+* tainers (e.g. BDIndexMap, std::map).
+****************************************************************/
+class Atom {
+
+public:
+    constexpr Atom() : m_id( invalid ) {}
+    constexpr explicit Atom( uint32_t id ) : m_id( id ) {}
+
+    constexpr uint32_t id()    const { return m_id; }
+    constexpr bool     valid() const { return m_id != invalid; }
+
+    constexpr bool operator==( Atom rhs ) const
+        { return m_id == rhs.m_id; }
+    constexpr bool operator!=( Atom rhs ) const
+        { return m_id != rhs.m_id; }
+    constexpr bool operator< ( Atom rhs ) const
+        { return m_id <  rhs.m_id; }
+
+private:
+    static constexpr uint32_t invalid = uint32_t( -1 );
+
+    uint32_t m_id;
+};
+
+// Prints the numeric id of the atom; to print the string use the
+// Interner that created it.
+std::ostream& operator<<( std::ostream& out, Atom a );
+
+/****************************************************************
+* Interner
+*
+* Thread-safe table mapping strings to Atoms and back. Each unique
+* string  is  stored exactly once, in an arena owned by the inter-
+* ner, and the string_views handed out by str() remain valid  for
+* the  lifetime  of the interner. Strings are never removed.
+*
+* The  table  is  split  into  a number of shards (selected by the
+* hash of the string), each with its own lock, so that threads in-
+* terning different strings rarely contend with each  other.  The
+* shard  number  is stored in the low bits of the atom's id so that
+* mapping an atom back to its string does not need to search.
+****************************************************************/
+class Interner : util::non_copy_non_move {
+
+public:
+    Interner();
+
+    // Returns the atom for the given string, adding it to the ta-
+    // ble if it is not already there.
+    Atom intern( std::string_view s );
+
+    // Returns  the  atom for the given string only if it has al-
+    // ready been interned; never modifies the table.
+    std::optional<Atom> find( std::string_view s ) const;
+
+    // Get the string for an atom. Will throw if the atom did  not
+    // come from this interner.
+    std::string_view str( Atom a ) const;
+
+    // Total number of unique strings interned.
+    size_t size() const;
+
+private:
+    static constexpr uint32_t shard_bits = 4;
+    static constexpr uint32_t num_shards = 1u << shard_bits;
+    static constexpr uint32_t shard_mask = num_shards - 1;
+
+    // Append-only storage for the bytes of the strings. Memory is
+    // allocated  in large blocks which are never moved so that the
+    // string_views into them remain valid.
+    class Arena {
+    public:
+        std::string_view store( std::string_view s );
+    private:
+        static constexpr size_t block_size = 64*1024;
+
+        std::vector<std::unique_ptr<char[]>> m_blocks;
+        char*  m_cur  = nullptr;
+        size_t m_left = 0;
+    };
+
+    struct Shard {
+        mutable std::shared_mutex                      mutex;
+        std::unordered_map<std::string_view, uint32_t> ids;
+        // Indexed by the local (within-shard) part of the id.
+        std::vector<std::string_view>                  strs;
+        Arena                                          arena;
+    };
+
+    static uint32_t shard_of( std::string_view s );
+
+    std::array<Shard, num_shards> m_shards;
+};
+
+} // namespace util
+
+namespace std {
+
+    template<> struct hash<::util::Atom> {
+        size_t operator()( ::util::Atom a ) const noexcept {
+            return hash<uint32_t>{}( a.id() );
+        }
+    };
+
+} // namespace std
@@ -2,6 +2,7 @@
 * IO related utilities
 ****************************************************************/
 #include "io.hpp"
+#include "latency.hpp"
 #include "macros.hpp"
 #include "util.hpp"
 
@@ -9,6 +10,13 @@
 #include <fstream>
 #include <regex>
 
+#ifndef _WIN32
+#    include <fcntl.h>
+#    include <sys/mman.h>
+#    include <sys/stat.h>
+#    include <unistd.h>
+#endif
+
 using namespace std;
 
 using gsl::owner;
@@ -21,6 +29,9 @@ namespace util {
 // don't actually need.
 vector<char> read_file( fs::path const& p ) {
 
+    static auto& hist = latency_histogram( "util::read_file" );
+    TIMED_SCOPE( hist );
+
     ASSERT( fs::exists( p ), "file " << p << " does not exist" );
 
     size_t size = fs::file_size( p );
@@ -204,4 +215,70 @@ PathVec wildcard( fs::path const& p, bool with_folders ) {
     return res;
 }
 
+MappedFile::MappedFile( fs::path const& p )
+    : m_data( nullptr ), m_size( 0 )
+#ifdef _WIN32
+    , m_buf()
+#endif
+{
+#ifdef _WIN32
+    m_buf  = read_file( p );
+    m_data = m_buf.data();
+    m_size = m_buf.size();
+#else
+    int fd = open( p.string().c_str(), O_RDONLY );
+    ASSERT( fd >= 0, "failed to open file " << p );
+    // Take the size from the descriptor (rather than the path) so
+    // that nothing can throw between here and the close below.
+    struct stat st;
+    bool  ok   = fstat( fd, &st ) == 0;
+    void* addr = nullptr;
+    m_size = ok ? size_t( st.st_size ) : 0;
+    // Can't map zero bytes; leave data as nullptr.
+    if( m_size > 0 )
+        addr = mmap( nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+    // Close before checking for errors; the mapping stays valid
+    // after the file descriptor is closed.
+    close( fd );
+    ASSERT( ok, "failed to stat file " << p );
+    ASSERT( addr != MAP_FAILED, "failed to mmap file " << p );
+    m_data = static_cast<char const*>( addr );
+#endif
+}
+
+MappedFile::~MappedFile() { release(); }
+
+MappedFile::MappedFile( MappedFile&& rhs ) noexcept
+    : m_data( rhs.m_data ), m_size( rhs.m_size )
+#ifdef _WIN32
+    , m_buf( move( rhs.m_buf ) )
+#endif
+{
+    rhs.m_data = nullptr;
+    rhs.m_size = 0;
+}
+
+MappedFile& MappedFile::operator=( MappedFile&& rhs ) noexcept {
+    if( this != &rhs ) {
+        release();
+        m_data = rhs.m_data;
+        m_size = rhs.m_size;
+#ifdef _WIN32
+        m_buf  = move( rhs.m_buf );
+#endif
+        rhs.m_data = nullptr;
+        rhs.m_size = 0;
+    }
+    return *this;
+}
+
+void MappedFile::release() {
+#ifndef _WIN32
+    if( m_data )
+        munmap( const_cast<char*>( m_data ), m_size );
+#endif
+    m_data = nullptr;
+    m_size = 0;
+}
+
 } // util
@@ -4,6 +4,7 @@
 #pragma once
 
 #include "fs.hpp"
+#include "non-copyable.hpp"
 #include "types.hpp"
 
 namespace util {
@@ -51,4 +52,31 @@ StrVec read_file_lines( fs::path const& p );
 // names begin with a dot ("hidden files" on Linux).
 PathVec wildcard( fs::path const& p, bool with_folders = true );
 
+// A read-only view of the contents of a file, memory-mapped where
+// the platform allows it so that opening is O(1) and pages are on-
+// ly read from disk when touched (on other platforms the file  is
+// read in its entirety). The data remains valid for the lifetime
+// of the object. Throws if the file can't be opened or mapped.
+class MappedFile : util::movable_only {
+
+public:
+    explicit MappedFile( fs::path const& p );
+    ~MappedFile();
+
+    MappedFile( MappedFile&& rhs ) noexcept;
+    MappedFile& operator=( MappedFile&& rhs ) noexcept;
+
+    char const* data() const { return m_data; }
+    size_t      size() const { return m_size; }
+
+private:
+    void release();
+
+    char const*       m_data;
+    size_t            m_size;
+#ifdef _WIN32
+    std::vector<char> m_buf;
+#endif
+};
+
 } // namespace std
@@ -0,0 +1,170 @@
+/****************************************************************
+* Latency histograms
+****************************************************************/
+#include "latency.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <map>
+#include <memory>
+#include <mutex>
+
+using namespace std;
+
+namespace util {
+
+namespace {
+
+struct Registry {
+    mutex                                        mtx;
+    map<string, unique_ptr<LatencyHistogram>, less<>> hists;
+};
+
+Registry& registry() {
+    static Registry r;
+    return r;
+}
+
+// Formats nanoseconds with units chosen for readability, to three
+// significant digits (two below 10). The unit is promoted if the
+// value would round up to 1000, so that e.g. 999.7ns is "1us" and
+// not "1e+03ns".
+void write_ns( ostream& out, double ns ) {
+    char const* unit = "ns";
+    for( char const* u : { "us", "ms", "s" } ) {
+        if( ns < 999.5 ) break;
+        ns /= 1000.0;
+        unit = u;
+    }
+    if( ns < 999.5 )
+        out << setprecision( ns < 10.0 ? 2 : 3 ) << ns << unit;
+    else
+        // Only when seconds run out of digits.
+        out << fixed << setprecision( 0 ) << ns << unit;
+}
+
+} // anonymous namespace
+
+LatencyHistogram::LatencyHistogram()
+    : m_buckets(), m_sum( 0 ), m_max( 0 ) {
+    reset();
+}
+
+void LatencyHistogram::reset() {
+    for( auto& b : m_buckets )
+        b.store( 0, memory_order_relaxed );
+    m_sum.store( 0, memory_order_relaxed );
+    m_max.store( 0, memory_order_relaxed );
+}
+
+void LatencyHistogram::merge( LatencyHistogram const& rhs ) {
+    for( size_t i = 0; i < num_buckets; ++i )
+        if( auto c = rhs.m_buckets[i].load( memory_order_relaxed ); c )
+            m_buckets[i].fetch_add( c, memory_order_relaxed );
+    m_sum.fetch_add( rhs.m_sum.load( memory_order_relaxed ),
+                     memory_order_relaxed );
+    auto rhs_max = rhs.m_max.load( memory_order_relaxed );
+    auto max     = m_max.load( memory_order_relaxed );
+    while( rhs_max > max &&
+           !m_max.compare_exchange_weak( max, rhs_max,
+               memory_order_relaxed ) ) {}
+}
+
+uint64_t LatencyHistogram::bucket_max( size_t b ) {
+    if( b < sub_count )
+        return b;
+    int      e     = int( b/sub_count ) + sub_bits - 1;
+    uint64_t sub   = b % sub_count;
+    uint64_t width = uint64_t( 1 ) << (e-sub_bits);
+    return ((sub_count + sub) << (e-sub_bits)) + width - 1;
+}
+
+LatencyHistogram::Counts LatencyHistogram::snapshot() const {
+    Counts res;
+    for( size_t i = 0; i < num_buckets; ++i )
+        res[i] = m_buckets[i].load( memory_order_relaxed );
+    return res;
+}
+
+uint64_t LatencyHistogram::percentile( Counts const& counts,
+                                       uint64_t total, double p,
+                                       uint64_t max ) {
+    if( total == 0 )
+        return 0;
+    // Rank of the sample we want, from one.
+    auto rank = uint64_t( ceil( clamp( p, 0.0, 1.0 )*double( total ) ) );
+    rank = std::max( rank, uint64_t( 1 ) );
+    uint64_t seen = 0;
+    for( size_t i = 0; i < num_buckets; ++i ) {
+        seen += counts[i];
+        if( seen >= rank )
+            return min( bucket_max( i ), max );
+    }
+    return max;
+}
+
+uint64_t LatencyHistogram::count() const {
+    uint64_t res = 0;
+    for( auto const& b : m_buckets )
+        res += b.load( memory_order_relaxed );
+    return res;
+}
+
+uint64_t LatencyHistogram::percentile( double p ) const {
+    auto counts = snapshot();
+    uint64_t total = 0;
+    for( auto c : counts ) total += c;
+    return percentile( counts, total, p,
+                       m_max.load( memory_order_relaxed ) );
+}
+
+LatencyHistogram::Summary LatencyHistogram::summary() const {
+    auto counts = snapshot();
+    Summary s{};
+    for( auto c : counts ) s.count += c;
+    s.max  = m_max.load( memory_order_relaxed );
+    s.mean = s.count ? double( m_sum.load( memory_order_relaxed ) ) /
+                       double( s.count ) : 0.0;
+    s.p50  = percentile( counts, s.count, 0.50,  s.max );
+    s.p90  = percentile( counts, s.count, 0.90,  s.max );
+    s.p99  = percentile( counts, s.count, 0.99,  s.max );
+    s.p999 = percentile( counts, s.count, 0.999, s.max );
+    return s;
+}
+
+ostream& operator<<( ostream& out, LatencyHistogram::Summary const& s ) {
+    auto flags = out.flags();
+    auto prec  = out.precision();
+    out << "n=" << s.count << " mean=";   write_ns( out, s.mean );
+    out << " p50=";   write_ns( out, double( s.p50  ) );
+    out << " p90=";   write_ns( out, double( s.p90  ) );
+    out << " p99=";   write_ns( out, double( s.p99  ) );
+    out << " p99.9="; write_ns( out, double( s.p999 ) );
+    out << " max=";   write_ns( out, double( s.max  ) );
+    out.flags( flags );
+    out.precision( prec );
+    return out;
+}
+
+LatencyHistogram& latency_histogram( string_view name ) {
+    auto& r = registry();
+    lock_guard<mutex> lock( r.mtx );
+    auto it = r.hists.find( name );
+    if( it == r.hists.end() )
+        it = r.hists.emplace( string( name ),
+                make_unique<LatencyHistogram>() ).first;
+    return *it->second;
+}
+
+vector<pair<string, LatencyHistogram::Summary>> latency_report() {
+    vector<pair<string, LatencyHistogram::Summary>> res;
+    auto& r = registry();
+    lock_guard<mutex> lock( r.mtx );
+    for( auto const& [name, hist] : r.hists )
+        if( auto s = hist->summary(); s.count > 0 )
+            res.emplace_back( name, s );
+    return res;
+}
+
+} // namespace util
@@ -0,0 +1,164 @@
+/****************************************************************
+* Latency histograms
+****************************************************************/
+#pragma once
+
+#include "macros.hpp"
+#include "non-copyable.hpp"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace util {
+
+/****************************************************************
+* LatencyHistogram
+*
+* Records  a distribution of durations (in nanoseconds) so that,
+* unlike with StopWatch, an event that happens a million times
+* gives a million samples from which percentiles can be  taken.
+*
+* Buckets  are  log-linear  (as  in  HdrHistogram): each power of
+* two  range  is  split  into  32  equal  sub-buckets,  so  that a
+* reported value is within about 3% of the true one across  the
+* whole  range  of  uint64, with a fixed table of ~2000 counters.
+* Recording  is  a  few relaxed atomic adds and so is thread-safe
+* and  cheap  enough  to  leave  enabled;  where many threads re-
+* cord the same event at a high rate they can instead each re-
+* cord into their own histogram and merge them afterwards.
+****************************************************************/
+class LatencyHistogram : util::non_copy_non_move {
+
+public:
+    LatencyHistogram();
+
+    void record( uint64_t ns ) {
+        m_buckets[bucket_of( ns )].fetch_add( 1,
+            std::memory_order_relaxed );
+        m_sum.fetch_add( ns, std::memory_order_relaxed );
+        auto max = m_max.load( std::memory_order_relaxed );
+        while( ns > max &&
+               !m_max.compare_exchange_weak( max, ns,
+                   std::memory_order_relaxed ) ) {}
+    }
+
+    // Adds the samples of rhs to this one.
+    void merge( LatencyHistogram const& rhs );
+
+    void reset();
+
+    struct Summary {
+        uint64_t count;
+        double   mean;
+        uint64_t p50, p90, p99, p999;
+        uint64_t max;
+    };
+
+    Summary summary() const;
+
+    // Value below which the given fraction (in [0,1]) of samples
+    // fall, as the upper end of the bucket containing it (but no
+    // more than the max).
+    uint64_t percentile( double p ) const;
+
+    uint64_t count() const;
+
+private:
+    // Sub-buckets per power of two.
+    static constexpr int    sub_bits    = 5;
+    static constexpr size_t sub_count   = size_t( 1 ) << sub_bits;
+    static constexpr size_t num_buckets = (64-sub_bits+1)*sub_count;
+
+    // Values below sub_count each get their own bucket;  above
+    // that the bucket is given by the position of the highest set
+    // bit followed by the next sub_bits bits.
+    static size_t bucket_of( uint64_t v ) {
+        if( v < sub_count )
+            return size_t( v );
+        int e = 63 - clz64( v );
+        return size_t( e-sub_bits+1 )*sub_count +
+               size_t( (v >> (e-sub_bits)) & (sub_count-1) );
+    }
+
+    // Largest value that falls in the bucket.
+    static uint64_t bucket_max( size_t b );
+
+    static int clz64( uint64_t v ) {
+#ifdef __GNUC__
+        return __builtin_clzll( v );
+#else
+        int n = 0;
+        for( ; !(v & (uint64_t( 1 ) << 63)); v <<= 1 ) ++n;
+        return n;
+#endif
+    }
+
+    using Counts = std::array<uint64_t, num_buckets>;
+
+    // Copy of the counts, so that all  percentiles  of  a  summary
+    // are taken from the same samples while recording continues.
+    Counts snapshot() const;
+
+    static uint64_t percentile( Counts const& counts, uint64_t total,
+                                double p, uint64_t max );
+
+    std::array<std::atomic<uint64_t>, num_buckets> m_buckets;
+    std::atomic<uint64_t>                          m_sum;
+    std::atomic<uint64_t>                          m_max;
+};
+
+// Prints count, mean, percentiles and max with units chosen  for
+// readability, e.g. "n=1000 mean=1.2us p50=1.1us ... max=15us".
+std::ostream& operator<<( std::ostream&                      out,
+                          LatencyHistogram::Summary const& s );
+
+// Histograms registered by name so that they can be defined  next
+// to the code that they time and reported together. The returned
+// reference remains valid for the life of the program; it should
+// be held in a static so that the lookup is only done once:
+//
+//   static auto& hist = util::latency_histogram( "read_file" );
+//   TIMED_SCOPE( hist );
+//
+LatencyHistogram& latency_histogram( std::string_view name );
+
+// Summaries of all the registered histograms that have at  least
+// one sample, sorted by name.
+std::vector<std::pair<std::string, LatencyHistogram::Summary>>
+latency_report();
+
+// Records the time between construction and destruction into the
+// histogram.
+class LatencyTimer {
+
+public:
+    explicit LatencyTimer( LatencyHistogram& hist )
+        : m_hist( hist ), m_start( clock::now() ) {}
+
+    ~LatencyTimer() {
+        m_hist.record( uint64_t(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                clock::now() - m_start ).count() ) );
+    }
+
+    LatencyTimer( LatencyTimer const& )            = delete;
+    LatencyTimer& operator=( LatencyTimer const& ) = delete;
+
+private:
+    using clock = std::chrono::steady_clock;
+
+    LatencyHistogram& m_hist;
+    clock::time_point m_start;
+};
+
+} // namespace util
+
+#define TIMED_SCOPE( hist )                                    \
+    ::util::LatencyTimer STRING_JOIN( timed_scope_, __LINE__ )( hist )
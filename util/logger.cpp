@@ -3,15 +3,158 @@
 ****************************************************************/
 #include "logger.hpp"
 
+#include <condition_variable>
+#include <mutex>
+#include <streambuf>
+#include <thread>
+
+using namespace std;
+
 namespace util {
 
-bool Logger::enabled = false;
+namespace {
+
+// Stream buffer that appends to a string.
+class StringBuf : public streambuf {
+
+public:
+    string text;
+
+protected:
+    int_type overflow( int_type c ) override {
+        if( c != traits_type::eof() )
+            text += char( c );
+        return c;
+    }
+
+    streamsize xsputn( char const* s, streamsize n ) override {
+        text.append( s, size_t( n ) );
+        return n;
+    }
+};
+
+struct ThreadBuf {
+    ThreadBuf() : buf(), out( &buf ), scanned( 0 ) {}
+
+    // Don't lose a partial last line when the thread exits.
+    ~ThreadBuf() {
+        if( !buf.text.empty() )
+            Logger::logger().flush();
+    }
+
+    StringBuf buf;
+    ostream   out;
+    // Length of the prefix of buf.text known to have no newlines.
+    size_t    scanned;
+};
+
+ThreadBuf& thread_buf() {
+    thread_local ThreadBuf tb;
+    return tb;
+}
+
+} // anonymous namespace
+
+struct Logger::Impl {
+    mutex              mtx;
+    condition_variable cv_work;
+    condition_variable cv_done;
+    // Text waiting to be written, possibly from many threads.
+    string             pending;
+    // Sequence numbers of the last text queued and written.
+    uint64_t           queued  = 0;
+    uint64_t           written = 0;
+    bool               stop    = false;
+    thread             writer;
+
+    void run() {
+        unique_lock<mutex> lock( mtx );
+        while( true ) {
+            cv_work.wait( lock, [this]{
+                return stop || !pending.empty(); } );
+            if( pending.empty() )
+                break; // stopping, and nothing left to write.
+            string   batch;
+            uint64_t upto = queued;
+            batch.swap( pending );
+            lock.unlock();
+            cout.write( batch.data(), streamsize( batch.size() ) );
+            cout.flush();
+            lock.lock();
+            written = upto;
+            cv_done.notify_all();
+        }
+    }
+};
+
+atomic<bool>     Logger::enabled{ false };
+atomic<LogLevel> Logger::level{ LogLevel::debug };
+
+Logger::Logger() : m_impl( make_unique<Impl>() ) {}
+
+Logger::~Logger() {
+    {
+        lock_guard<mutex> lock( m_impl->mtx );
+        m_impl->stop = true;
+    }
+    m_impl->cv_work.notify_one();
+    if( m_impl->writer.joinable() )
+        m_impl->writer.join();
+}
 
 Logger& Logger::logger() noexcept {
     static Logger global_logger;
     return global_logger;
 }
 
+uint64_t Logger::enqueue( string&& s ) {
+    uint64_t seq;
+    {
+        lock_guard<mutex> lock( m_impl->mtx );
+        // Start the writer on first use so that programs that don't
+        // log don't have an extra thread.
+        if( !m_impl->writer.joinable() )
+            m_impl->writer = thread( [this]{ m_impl->run(); } );
+        if( m_impl->pending.empty() )
+            m_impl->pending = move( s );
+        else
+            m_impl->pending += s;
+        seq = ++m_impl->queued;
+    }
+    m_impl->cv_work.notify_one();
+    return seq;
+}
+
+ostream& Logger::stream() { return thread_buf().out; }
+
+void Logger::commit() {
+    auto&   tb   = thread_buf();
+    string& text = tb.buf.text;
+    // Look for the last newline in what has been added since the
+    // last call.
+    size_t end = text.size();
+    while( end > tb.scanned && text[end-1] != '\n' )
+        --end;
+    if( end > tb.scanned ) {
+        enqueue( text.substr( 0, end ) );
+        text.erase( 0, end );
+    }
+    tb.scanned = text.size();
+}
+
+void Logger::flush() {
+    auto& tb = thread_buf();
+    if( !tb.buf.text.empty() ) {
+        enqueue( move( tb.buf.text ) );
+        tb.buf.text.clear();
+        tb.scanned = 0;
+    }
+    unique_lock<mutex> lock( m_impl->mtx );
+    uint64_t target = m_impl->queued;
+    m_impl->cv_done.wait( lock, [&]{
+        return m_impl->written >= target; } );
+}
+
 /* This is a reference to the  global  logger  object  for  conve-
  * nience, similarly to cout/cerr. */
 Logger& log = Logger::logger();
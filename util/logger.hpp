@@ -5,24 +5,67 @@
 
 #include "non-copyable.hpp"
 
+#include <atomic>
+#include <cstdint>
 #include <iostream>
+#include <memory>
+#include <string>
 
 namespace util {
 
+enum class LogLevel : int {
+    debug   = 0,
+    info    = 1,
+    warning = 2,
+    error   = 3
+};
+
 /* This is a singleton class, the object of which will represent
- * the global logger object. */
+ * the global logger object.
+ *
+ * Output is asynchronous: each thread formats into its own buffer,
+ * and  each  complete line (i.e., up to and including a newline)
+ * is  handed  to a background thread which writes whatever lines
+ * have  accumulated  to  stdout  in a single call. So logging does
+ * not wait on the terminal, and lines logged from different thr-
+ * eads  (e.g.,  par::for_each workers) are never interleaved with
+ * each  other.  Text not (yet) ending in a newline stays in the
+ * thread's buffer until flush() is called from that thread. The
+ * writer thread is started on first use. */
 struct Logger : public singleton {
 
 public:
     // Get the global logger instance.
     static Logger& logger() noexcept;
 
-    // When this flag is  false,  logging  has  no  effect. If it
+    ~Logger();
+
+    // When this flag is  false,  logging  has  no  effect. It is
     // false by default.
-    static bool    enabled;
+    static std::atomic<bool>     enabled;
+
+    // Messages logged through the LOG_* macros below this  level
+    // are  discarded. Plain `util::log << ...` is not affected.
+    static std::atomic<LogLevel> level;
+
+    // Writes all lines logged so far, from all threads, plus any
+    // partial line of the calling thread, and waits until they've
+    // been written.
+    void flush();
+
+    // Used by operator<<: the calling thread's buffer, and sending
+    // any complete lines in it to the writer.
+    std::ostream& stream();
+    void          commit();
 
 private:
-    Logger() = default;
+    Logger();
+
+    // Hands text to the writer and returns its sequence number.
+    uint64_t enqueue( std::string&& s );
+
+    struct Impl;
+    std::unique_ptr<Impl> m_impl;
 
 };
 
@@ -32,8 +75,8 @@ private:
  * sion. */
 extern Logger& log;
 
-// This  operator  overload simply forwards requests to cout when
-// logging is enabled, otherwise does nothing.
+// This  operator  overload formats the item into the calling thr-
+// ead's log buffer when logging is enabled, otherwise does nothing.
 template<typename T>
 Logger& operator<<( Logger& lgr, T const& item ) {
 
@@ -42,10 +85,35 @@ Logger& operator<<( Logger& lgr, T const& item ) {
     // our  custom  operator<<  overloads  from  the util library.
     using ::util::operator<<;
 
-    if( Logger::enabled )
-        std::cout << item;
+    if( Logger::enabled.load( std::memory_order_relaxed ) ) {
+        lgr.stream() << item;
+        lgr.commit();
+    }
 
     return lgr;
 }
 
 } // namespace util
+
+// Messages  below  this  level are removed at compile time by the
+// LOG_* macros (0=debug, 1=info, 2=warning, 3=error).
+#ifndef LOG_MIN_LEVEL
+#    define LOG_MIN_LEVEL 0
+#endif
+
+// Usage: LOG_INFO << "processed " << n << " files\n";
+//
+// The  check  is done once per statement, and if it fails none of
+// the items are evaluated.
+#define LOG_AT( lvl, tag )                                     \
+    if( !(int( ::util::LogLevel::lvl ) >= LOG_MIN_LEVEL &&     \
+          ::util::Logger::enabled.load(                        \
+              std::memory_order_relaxed ) &&                   \
+          ::util::LogLevel::lvl >= ::util::Logger::level.load( \
+              std::memory_order_relaxed )) ) {}                \
+    else ::util::log << tag
+
+#define LOG_DEBUG   LOG_AT( debug,   "[debug] "   )
+#define LOG_INFO    LOG_AT( info,    "[info] "    )
+#define LOG_WARNING LOG_AT( warning, "[warning] " )
+#define LOG_ERROR   LOG_AT( error,   "[error] "   )
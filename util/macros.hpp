@@ -51,3 +51,12 @@
     }   STRING_JOIN( obj, __LINE__ );                          \
     STRING_JOIN( register_, __LINE__ )::                       \
         STRING_JOIN( register_, __LINE__ )()
+
+// Hint  to  the  CPU  to  start  loading the cache line holding the
+// given address; expands to nothing on compilers that don't sup-
+// port it. The address does not need to be dereferenceable.
+#ifdef __GNUC__
+#    define PREFETCH( a ) __builtin_prefetch( a )
+#else
+#    define PREFETCH( a ) ((void)(a))
+#endif
@@ -0,0 +1,192 @@
+/****************************************************************
+* Multi-pattern substring search
+****************************************************************/
+#include "multi-match.hpp"
+#include "macros.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace std;
+
+namespace util {
+
+namespace {
+
+// Marks a transition that has not been computed yet during const-
+// ruction of the automaton.
+constexpr uint32_t undefined = uint32_t( -1 );
+
+} // anonymous namespace
+
+MultiMatcher::MultiMatcher( vector<string> const& patterns )
+    : m_class(),
+      m_num_classes( 1 ),
+      m_delta(),
+      m_out(),
+      m_dict_link(),
+      m_pattern_lens(),
+      m_same(),
+      m_first_byte(),
+      m_single_first() {
+
+    // Assign  an  equivalence class to each byte that appears in
+    // any pattern; all other bytes remain in class zero.
+    m_class.fill( 0 );
+    for( auto const& p : patterns ) {
+        ASSERT( !p.empty(), "MultiMatcher patterns must not be "
+                            "empty" );
+        for( unsigned char c : p )
+            if( m_class[c] == 0 )
+                m_class[c] = uint16_t( m_num_classes++ );
+    }
+
+    auto add_state = [this] {
+        m_delta.resize( m_delta.size() + m_num_classes, undefined );
+        m_out.push_back( -1 );
+        return State( m_out.size()-1 );
+    };
+
+    // Build the trie.
+    add_state(); // root
+    m_first_byte.fill( false );
+    m_same.assign( patterns.size(), -1 );
+    for( size_t i = 0; i < patterns.size(); ++i ) {
+        State s = root;
+        for( unsigned char c : patterns[i] ) {
+            auto& t = m_delta[s*m_num_classes + m_class[c]];
+            if( t == undefined ) {
+                // Must  not  hold  on  to  the reference across
+                // add_state since it resizes the table.
+                State n = add_state();
+                m_delta[s*m_num_classes + m_class[c]] = n;
+            }
+            s = m_delta[s*m_num_classes + m_class[c]];
+        }
+        // Duplicate patterns end in the same state so chain them.
+        m_same[i] = m_out[s];
+        m_out[s]  = int32_t( i );
+        m_pattern_lens.push_back( patterns[i].size() );
+        m_first_byte[(unsigned char)patterns[i][0]] = true;
+    }
+
+    size_t num_first = 0;
+    for( size_t c = 0; c < m_first_byte.size(); ++c )
+        if( m_first_byte[c] ) {
+            ++num_first;
+            m_single_first = (unsigned char)c;
+        }
+    if( num_first != 1 )
+        m_single_first = nullopt;
+
+    // Compute the failure links in breadth-first order, and at the
+    // same  time fill in the missing transitions of the DFA by fol-
+    // lowing  them;  this works because the failure link of a state
+    // always points to a shallower state, which  will  have  been
+    // completed already.
+    vector<State> fail( m_out.size(), root );
+    m_dict_link.assign( m_out.size(), root );
+    vector<State> queue; queue.reserve( m_out.size() );
+    queue.push_back( root );
+    for( size_t qi = 0; qi < queue.size(); ++qi ) {
+        State s = queue[qi];
+        for( size_t c = 0; c < m_num_classes; ++c ) {
+            auto& t = m_delta[s*m_num_classes + c];
+            State via_fail = (s == root)
+                ? root : m_delta[fail[s]*m_num_classes + c];
+            if( t == undefined ) {
+                t = via_fail;
+                continue;
+            }
+            fail[t] = via_fail;
+            // The dictionary link skips over  states  along  the
+            // failure chain that don't have any output.
+            m_dict_link[t] = (m_out[via_fail] >= 0)
+                ? via_fail : m_dict_link[via_fail];
+            queue.push_back( t );
+        }
+    }
+}
+
+template<typename Func>
+void MultiMatcher::scan( string_view sv, Func f ) const {
+    auto const*  data = (unsigned char const*)sv.data();
+    size_t const n    = sv.size();
+    State s = root;
+    for( size_t i = 0; i < n; ++i ) {
+        if( s == root ) {
+            // Skip  ahead  to  the  next byte that could begin a
+            // match, since until then we'd stay in the root.
+            if( m_single_first ) {
+                auto p = memchr( data+i, *m_single_first, n-i );
+                if( !p ) return;
+                i = (unsigned char const*)p - data;
+            } else {
+                while( i < n && !m_first_byte[data[i]] ) ++i;
+                if( i == n ) return;
+            }
+        }
+        s = next( s, data[i] );
+        if( m_out[s] >= 0 || m_dict_link[s] != root )
+            if( !f( s, i ) )
+                return;
+    }
+}
+
+bool MultiMatcher::any_of( string_view sv ) const {
+    bool found = false;
+    scan( sv, [&]( State, size_t ) { found = true; return false; } );
+    return found;
+}
+
+optional<MultiMatcher::Match>
+MultiMatcher::first_match( string_view sv ) const {
+    optional<Match> res;
+    scan( sv, [&]( State s, size_t end ) {
+        // The output of the state itself (if any) is the longest
+        // pattern ending here; otherwise take the longest one along
+        // the dictionary links.
+        if( m_out[s] < 0 )
+            s = m_dict_link[s];
+        // If there are duplicates, report the first one.
+        auto p = size_t( m_out[s] );
+        while( m_same[p] >= 0 )
+            p = size_t( m_same[p] );
+        res = Match{ p, end+1-m_pattern_lens[p] };
+        return false;
+    });
+    return res;
+}
+
+vector<MultiMatcher::Match>
+MultiMatcher::all_matches( string_view sv ) const {
+    vector<Match> res;
+    scan( sv, [&]( State s, size_t end ) {
+        if( m_out[s] < 0 )
+            s = m_dict_link[s];
+        for( ; s != root; s = m_dict_link[s] )
+            for( auto p = m_out[s]; p >= 0; p = m_same[p] )
+                res.push_back( Match{ size_t( p ),
+                    end+1-m_pattern_lens[p] } );
+        return true;
+    });
+    return res;
+}
+
+vector<size_t> MultiMatcher::matching_lines( string_view text ) const {
+    vector<size_t> res;
+    size_t line = 0;
+    while( !text.empty() ) {
+        auto nl = min( text.find( '\n' ), text.size() );
+        auto l  = text.substr( 0, nl );
+        if( !l.empty() && l.back() == '\r' )
+            l.remove_suffix( 1 );
+        if( any_of( l ) )
+            res.push_back( line );
+        text.remove_prefix( min( nl+1, text.size() ) );
+        ++line;
+    }
+    return res;
+}
+
+} // namespace util
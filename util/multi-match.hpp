@@ -0,0 +1,119 @@
+/****************************************************************
+* Multi-pattern substring search
+****************************************************************/
+#pragma once
+
+#include "types.hpp"
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace util {
+
+/****************************************************************
+* MultiMatcher
+*
+* This  is  the  multi-pattern  counterpart of util::contains: it
+* is compiled once from a set of patterns and then can test  any
+* number  of  strings against all of the patterns at once in time
+* proportional to the length of the string (plus the number  of
+* matches  reported),  independent  of  the  number of patterns.
+*
+* Internally it is an Aho-Corasick automaton  that  is  compiled
+* into  a  full  DFA  over  an  alphabet of byte equivalence clas-
+* ses (bytes that don't appear in any pattern all share one class)
+* so that the table stays small even for  hundreds  of  patterns.
+* When  the  automaton is in its start state the scan skips ahead
+* to the next byte that can begin a pattern; if all patterns start
+* with  the same byte this is done with memchr, which the C libr-
+* ary typically vectorizes.
+*
+* Patterns  are  identified by their index in the vector given to
+* the constructor. Matching is case sensitive, and  patterns  may
+* overlap  or  contain  each other. Empty patterns are not allowed.
+****************************************************************/
+class MultiMatcher {
+
+public:
+    struct Match {
+        // Index of the pattern in the list given to the construc-
+        // tor.
+        size_t pattern;
+        // Offset into the searched string of the first char of the
+        // match.
+        size_t pos;
+
+        bool operator==( Match const& rhs ) const
+            { return pattern == rhs.pattern && pos == rhs.pos; }
+    };
+
+    explicit MultiMatcher( std::vector<std::string> const& patterns );
+
+    // Number of patterns.
+    size_t size() const { return m_pattern_lens.size(); }
+
+    // Does the string contain any of the patterns.
+    bool any_of( std::string_view sv ) const;
+
+    // Returns the match that ends first in the string; if multiple
+    // patterns end at the same position then the longest  one  is
+    // returned.
+    std::optional<Match> first_match( std::string_view sv ) const;
+
+    // Returns  all (possibly overlapping) matches in the order in
+    // which they end in the string.
+    std::vector<Match> all_matches( std::string_view sv ) const;
+
+    // Splits  the  text  into  lines (on \n, with any trailing \r
+    // ignored) and returns the zero-based numbers of  those  lines
+    // that contain any of the patterns. This  is  equivalent  to
+    // splitting the text and calling any_of on each line.
+    std::vector<size_t> matching_lines( std::string_view text ) const;
+
+private:
+    using State = uint32_t;
+
+    static constexpr State root = 0;
+
+    // Advance the automaton over sv starting at state s, calling
+    // f( state, pos ) on each position whose state has  at  least
+    // one  output, where pos is the offset of the last char of the
+    // match. If f returns false the scan stops.
+    template<typename Func>
+    void scan( std::string_view sv, Func f ) const;
+
+    State next( State s, unsigned char c ) const {
+        return m_delta[s*m_num_classes + m_class[c]];
+    }
+
+    // Maps each byte to its equivalence class.
+    std::array<uint16_t, 256> m_class;
+    size_t                    m_num_classes;
+
+    // The DFA: m_delta[state*m_num_classes + class].
+    std::vector<State> m_delta;
+
+    // For each state, the index of the pattern  that  ends  there
+    // (if any) and the next state along the dictionary suffix link
+    // chain that has an output (root if none).
+    std::vector<int32_t> m_out;
+    std::vector<State>   m_dict_link;
+
+    std::vector<size_t> m_pattern_lens;
+
+    // Patterns  that  are identical end in the same state, so for
+    // each pattern this gives the next one (if any) with the same
+    // text, forming a chain starting at m_out.
+    std::vector<int32_t> m_same;
+
+    // Bytes that can begin a pattern, used to skip through the
+    // text while in the root state.
+    std::array<bool, 256>        m_first_byte;
+    std::optional<unsigned char> m_single_first;
+};
+
+} // namespace util
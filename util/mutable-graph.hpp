@@ -0,0 +1,423 @@
+/****************************************************************
+* Mutable Graphs
+****************************************************************/
+#pragma once
+
+#include "bimap.hpp"
+#include "bitset.hpp"
+#include "graph.hpp"
+#include "macros.hpp"
+#include "non-copyable.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace util {
+
+/****************************************************************
+* MutableGraph
+*
+* A directed graph (not acyclic) that can be changed one node  or
+* edge  at  a  time  in amortized O(1), for when rebuilding a Di-
+* rectedGraph via make_graph after each small change is too  ex-
+* pensive. snapshot() produces an immutable DirectedGraph of the
+* current state when the faster queries of that class are needed.
+*
+* Two kinds of derived data are kept up to date as the graph chan-
+* ges, rather than being recomputed:
+*
+*   1. The set of nodes accessible from each node for which ac-
+*      cessible() has been called is cached. Adding an edge only
+*      extends the affected sets, by searching from the new edge's
+*      target over nodes not already in them. Removing an edge or
+*      node can shrink them, which is expensive to determine, so
+*      the affected sets (only those that contain the edge's
+*      source) are dropped and recomputed on their next use.
+*
+*   2. A  topological  order, maintained with the algorithm of
+*      Pearce and Kelly: adding an edge that violates the current
+*      order  reorders only the nodes between its endpoints. If an
+*      edge closes a cycle there is no topological order  and  it
+*      is  recomputed  from  scratch  (when asked for) after edges
+*      have been removed.
+*
+* Since  the  queries  fill  these caches they are not const, and
+* (as with the changes) calls to them must not overlap with  any
+* other call; take a snapshot() to query from several threads.
+****************************************************************/
+template<typename NameT>
+class MutableGraph : util::movable_only {
+
+public:
+    MutableGraph();
+
+    // Number of nodes and edges.
+    size_t size()      const { return m_ids.size(); }
+    size_t num_edges() const { return m_num_edges;  }
+
+    bool contains( NameT const& name ) const
+        { return bool( m_ids.find_key( name ) ); }
+
+    // Returns false if the node was already there.
+    bool add_node( NameT const& name );
+    // Also removes the edges to and from the node. Returns false if
+    // the node was not there.
+    bool remove_node( NameT const& name );
+
+    // Adds the nodes first if they are not there. Returns false if
+    // the edge was already there.
+    bool add_edge( NameT const& from, NameT const& to );
+    // Returns false if the edge was not there.
+    bool remove_edge( NameT const& from, NameT const& to );
+
+    // Same as DirectedGraph::accessible; see above for caching.
+    std::vector<NameT> accessible( NameT const& name,
+                                   bool with_self = true );
+
+    // Is `to` accessible from `from`. Uses and fills the cache for
+    // `from`.
+    bool reachable( NameT const& from, NameT const& to );
+
+    // Drops all cached accessible sets.
+    void clear_cache() { m_reach.clear(); }
+
+    // nullopt if there is a cycle.
+    std::optional<std::vector<NameT>> topo_sort();
+
+    DirectedGraph<NameT> snapshot() const;
+
+private:
+    using Id = CsrGraph::Id;
+
+    NameT const& name_of( Id i ) const { return m_ids.key( i ); }
+
+    // Adds the node if needed and returns its id.
+    Id ensure_node( NameT const& name );
+
+    // Cached set for node s (computing it if needed).
+    DynBitset const& reach( Id s );
+
+    // Adds to `bits` everything reachable from v that is not
+    // already in it (v included).
+    void extend( DynBitset& bits, Id v );
+
+    // Drops the cached sets that contain node n.
+    void invalidate_containing( Id n );
+
+    // Pearce-Kelly reordering after adding edge (x,y) with
+    // ord[y] < ord[x]. Returns false if the edge closes a cycle.
+    bool reorder( Id x, Id y );
+
+    // Recomputes the order from scratch; false if there is a cycle.
+    bool recompute_order();
+
+    BiMap<NameT, Id>                    m_ids;
+    // Indexed by id; the entries of unused ids are empty.
+    std::vector<std::unordered_set<Id>> m_out;
+    std::vector<std::unordered_set<Id>> m_in;
+    std::vector<Id>                     m_free_ids;
+    size_t                              m_num_edges;
+
+    std::unordered_map<Id, DynBitset>   m_reach;
+
+    // Topological position of each node; only meaningful while
+    // m_order_valid is true.
+    std::vector<uint64_t>               m_ord;
+    uint64_t                            m_next_ord;
+    bool                                m_order_valid;
+
+    // Scratch space for searches.
+    DynBitset                           m_mark;
+    std::vector<Id>                     m_stack;
+};
+
+template<typename NameT>
+MutableGraph<NameT>::MutableGraph()
+    : m_ids(), m_out(), m_in(), m_free_ids(), m_num_edges( 0 ),
+      m_reach(), m_ord(), m_next_ord( 0 ), m_order_valid( true ),
+      m_mark(), m_stack() {}
+
+template<typename NameT>
+typename MutableGraph<NameT>::Id
+MutableGraph<NameT>::ensure_node( NameT const& name ) {
+
+    if( auto v = m_ids.val_safe( name ); v )
+        return *v;
+
+    Id i;
+    if( !m_free_ids.empty() ) {
+        i = m_free_ids.back(); m_free_ids.pop_back();
+    } else {
+        ASSERT( m_out.size() < uint32_t( -1 ),
+                "too many nodes in MutableGraph" );
+        i = Id( m_out.size() );
+        m_out.emplace_back();
+        m_in.emplace_back();
+        m_ord.push_back( 0 );
+        m_mark.resize( m_out.size() );
+        for( auto& [s, bits] : m_reach )
+            bits.resize( m_out.size() );
+    }
+    m_ids.insert( name, i );
+    // A node without edges can go anywhere in the order, so put
+    // it at the end.
+    m_ord[i] = m_next_ord++;
+    return i;
+}
+
+template<typename NameT>
+bool MutableGraph<NameT>::add_node( NameT const& name ) {
+    if( contains( name ) )
+        return false;
+    ensure_node( name );
+    return true;
+}
+
+template<typename NameT>
+bool MutableGraph<NameT>::remove_node( NameT const& name ) {
+
+    auto v = m_ids.val_safe( name );
+    if( !v )
+        return false;
+    Id n = *v;
+
+    invalidate_containing( n );
+    for( Id t : m_out[n] ) m_in[t].erase( n );
+    for( Id s : m_in[n]  ) m_out[s].erase( n );
+    // A self loop has been removed from m_in[n] by now, so it is
+    // only counted once here.
+    m_num_edges -= m_out[n].size() + m_in[n].size();
+    m_out[n].clear();
+    m_in[n].clear();
+    m_ids.erase_key( name );
+    m_free_ids.push_back( n );
+    // Removing a node can break a cycle; an existing order stays
+    // valid.
+    return true;
+}
+
+template<typename NameT>
+bool MutableGraph<NameT>::add_edge( NameT const& from,
+                                    NameT const& to ) {
+    Id x = ensure_node( from );
+    Id y = ensure_node( to );
+    if( !m_out[x].insert( y ).second )
+        return false;
+    m_in[y].insert( x );
+    ++m_num_edges;
+
+    for( auto& [s, bits] : m_reach )
+        if( bits.test( x ) && !bits.test( y ) )
+            extend( bits, y );
+
+    if( m_order_valid && m_ord[y] <= m_ord[x] )
+        m_order_valid = reorder( x, y );
+    return true;
+}
+
+template<typename NameT>
+bool MutableGraph<NameT>::remove_edge( NameT const& from,
+                                       NameT const& to ) {
+    auto x = m_ids.val_safe( from );
+    auto y = m_ids.val_safe( to   );
+    if( !x || !y || !m_out[*x].erase( *y ) )
+        return false;
+    m_in[*y].erase( *x );
+    --m_num_edges;
+    invalidate_containing( *x );
+    return true;
+}
+
+template<typename NameT>
+void MutableGraph<NameT>::invalidate_containing( Id n ) {
+    for( auto it = m_reach.begin(); it != m_reach.end(); ) {
+        if( it->second.test( n ) ) it = m_reach.erase( it );
+        else                       ++it;
+    }
+}
+
+template<typename NameT>
+void MutableGraph<NameT>::extend( DynBitset& bits, Id v ) {
+    m_stack.clear();
+    bits.set( v );
+    m_stack.push_back( v );
+    while( !m_stack.empty() ) {
+        Id n = m_stack.back(); m_stack.pop_back();
+        for( Id t : m_out[n] )
+            if( !bits.test_and_set( t ) )
+                m_stack.push_back( t );
+    }
+}
+
+template<typename NameT>
+DynBitset const& MutableGraph<NameT>::reach( Id s ) {
+    auto it = m_reach.find( s );
+    if( it == m_reach.end() ) {
+        it = m_reach.emplace( s, DynBitset( m_out.size() ) ).first;
+        extend( it->second, s );
+    }
+    return it->second;
+}
+
+template<typename NameT>
+std::vector<NameT>
+MutableGraph<NameT>::accessible( NameT const& name,
+                                 bool with_self ) {
+    std::vector<NameT> res;
+    auto s = m_ids.val_safe( name );
+    if( !s )
+        return res;
+    auto const& words = reach( *s ).words();
+    for( size_t w = 0; w < words.size(); ++w ) {
+        for( uint64_t m = words[w]; m; m &= m-1 ) {
+            auto n = Id( w*64 + ctz64( m ) );
+            if( n != *s || with_self )
+                res.push_back( name_of( n ) );
+        }
+    }
+    return res;
+}
+
+template<typename NameT>
+bool MutableGraph<NameT>::reachable( NameT const& from,
+                                     NameT const& to ) {
+    auto x = m_ids.val_safe( from );
+    auto y = m_ids.val_safe( to   );
+    return x && y && reach( *x ).test( *y );
+}
+
+template<typename NameT>
+bool MutableGraph<NameT>::reorder( Id x, Id y ) {
+
+    uint64_t const lb = m_ord[y], ub = m_ord[x];
+    std::vector<Id> fwd, bwd;
+
+    // Forward from y through the nodes ordered before x; finding x
+    // means the new edge closes a cycle.
+    bool cycle = false;
+    m_stack.assign( 1, y );
+    m_mark.set( y );
+    while( !m_stack.empty() && !cycle ) {
+        Id n = m_stack.back(); m_stack.pop_back();
+        fwd.push_back( n );
+        for( Id t : m_out[n] ) {
+            if( t == x ) { cycle = true; break; }
+            if( m_ord[t] < ub && !m_mark.test_and_set( t ) )
+                m_stack.push_back( t );
+        }
+    }
+    for( Id n : fwd )     m_mark.reset( n );
+    for( Id n : m_stack ) m_mark.reset( n );
+    if( cycle )
+        return false;
+
+    // Backward from x through the nodes ordered after y.
+    m_stack.assign( 1, x );
+    m_mark.set( x );
+    while( !m_stack.empty() ) {
+        Id n = m_stack.back(); m_stack.pop_back();
+        bwd.push_back( n );
+        for( Id s : m_in[n] )
+            if( m_ord[s] > lb && !m_mark.test_and_set( s ) )
+                m_stack.push_back( s );
+    }
+    for( Id n : bwd ) m_mark.reset( n );
+
+    // Reassign the positions held by the two sets so that all of
+    // bwd comes before all of fwd, keeping the existing relative
+    // order within each.
+    auto by_ord = [this]( Id a, Id b ) { return m_ord[a] < m_ord[b]; };
+    std::sort( bwd.begin(), bwd.end(), by_ord );
+    std::sort( fwd.begin(), fwd.end(), by_ord );
+    std::vector<uint64_t> slots;
+    for( Id n : bwd ) slots.push_back( m_ord[n] );
+    for( Id n : fwd ) slots.push_back( m_ord[n] );
+    std::sort( slots.begin(), slots.end() );
+    size_t i = 0;
+    for( Id n : bwd ) m_ord[n] = slots[i++];
+    for( Id n : fwd ) m_ord[n] = slots[i++];
+    return true;
+}
+
+template<typename NameT>
+bool MutableGraph<NameT>::recompute_order() {
+
+    // Kahn's algorithm over the live nodes.
+    std::vector<uint32_t> in_degree( m_out.size(), 0 );
+    std::vector<Id>       queue;
+    m_ids.for_each( [&]( NameT const&, Id n ) {
+        in_degree[n] = uint32_t( m_in[n].size() );
+        if( in_degree[n] == 0 )
+            queue.push_back( n );
+    });
+    for( size_t i = 0; i < queue.size(); ++i )
+        for( Id t : m_out[queue[i]] )
+            if( --in_degree[t] == 0 )
+                queue.push_back( t );
+    if( queue.size() != m_ids.size() )
+        return false;
+    m_next_ord = 0;
+    for( Id n : queue )
+        m_ord[n] = m_next_ord++;
+    return true;
+}
+
+template<typename NameT>
+std::optional<std::vector<NameT>>
+MutableGraph<NameT>::topo_sort() {
+
+    if( !m_order_valid && !(m_order_valid = recompute_order()) )
+        return std::nullopt;
+
+    std::vector<Id> ids; ids.reserve( size() );
+    m_ids.for_each( [&]( NameT const&, Id n ) { ids.push_back( n ); } );
+    std::sort( ids.begin(), ids.end(),
+               [this]( Id a, Id b ) { return m_ord[a] < m_ord[b]; } );
+
+    std::vector<NameT> res; res.reserve( ids.size() );
+    for( Id n : ids )
+        res.push_back( name_of( n ) );
+    return res;
+}
+
+template<typename NameT>
+DirectedGraph<NameT> MutableGraph<NameT>::snapshot() const {
+
+    // The ids of the snapshot are the positions of the names in
+    // sorted order.
+    std::vector<std::pair<NameT, Id>> sorted;
+    sorted.reserve( size() );
+    m_ids.for_each( [&]( NameT const& nm, Id n ) {
+        sorted.emplace_back( nm, n );
+    });
+    std::sort( sorted.begin(), sorted.end() );
+
+    std::vector<Id> new_id( m_out.size() );
+    for( size_t i = 0; i < sorted.size(); ++i )
+        new_id[sorted[i].second] = Id( i );
+
+    std::vector<uint32_t> offsets{ 0 };
+    std::vector<Id>       targets;
+    offsets.reserve( sorted.size()+1 );
+    targets.reserve( m_num_edges );
+    std::vector<NameT>    names;
+    names.reserve( sorted.size() );
+    for( auto& [nm, n] : sorted ) {
+        size_t begin = targets.size();
+        for( Id t : m_out[n] )
+            targets.push_back( new_id[t] );
+        std::sort( targets.begin()+begin, targets.end() );
+        offsets.push_back( uint32_t( targets.size() ) );
+        names.push_back( std::move( nm ) );
+    }
+
+    return DirectedGraph<NameT>(
+        CsrGraph( std::move( offsets ), std::move( targets ) ),
+        BDIndexMap<NameT>( std::move( names ), true ) );
+}
+
+} // namespace util
@@ -0,0 +1,197 @@
+/****************************************************************
+* Hardware performance counters
+****************************************************************/
+#include "perf-counters.hpp"
+
+#include <iomanip>
+
+#ifdef __linux__
+#    include <linux/perf_event.h>
+#    include <sys/ioctl.h>
+#    include <sys/syscall.h>
+#    include <unistd.h>
+#endif
+
+using namespace std;
+
+namespace util {
+
+char const* perf_event_name( PerfEvent e ) {
+    switch( e ) {
+        case PerfEvent::cycles:        return "cycles";
+        case PerfEvent::instructions:  return "instructions";
+        case PerfEvent::l1d_misses:    return "L1D-misses";
+        case PerfEvent::llc_misses:    return "LLC-misses";
+        case PerfEvent::branch_misses: return "branch-misses";
+    }
+    return "?";
+}
+
+optional<double> PerfSample::ipc() const {
+    auto c = (*this)[PerfEvent::cycles];
+    auto i = (*this)[PerfEvent::instructions];
+    if( !c || !i || *c == 0 )
+        return nullopt;
+    return double( *i ) / double( *c );
+}
+
+optional<double> PerfSample::mpki( PerfEvent e ) const {
+    auto n = (*this)[e];
+    auto i = (*this)[PerfEvent::instructions];
+    if( !n || !i || *i == 0 )
+        return nullopt;
+    return double( *n ) * 1000.0 / double( *i );
+}
+
+PerfSample operator-( PerfSample const& end, PerfSample const& start ) {
+    PerfSample res;
+    for( size_t i = 0; i < num_perf_events; ++i )
+        if( end.values[i] && start.values[i] )
+            // Scaled values are estimates so could go backwards.
+            res.values[i] = *end.values[i] >= *start.values[i]
+                          ? *end.values[i] - *start.values[i] : 0;
+    return res;
+}
+
+ostream& operator<<( ostream& out, PerfSample const& s ) {
+    bool first = true;
+    auto sep = [&]() -> ostream& {
+        if( !first ) out << ' ';
+        first = false;
+        return out;
+    };
+    for( size_t i = 0; i < num_perf_events; ++i )
+        if( s.values[i] )
+            sep() << perf_event_name( PerfEvent( i ) ) << '='
+                  << *s.values[i];
+    auto flags = out.flags();
+    auto prec  = out.precision();
+    out << fixed << setprecision( 2 );
+    if( auto ipc = s.ipc(); ipc )
+        sep() << "IPC=" << *ipc;
+    for( auto e : { PerfEvent::l1d_misses, PerfEvent::llc_misses,
+                    PerfEvent::branch_misses } )
+        if( auto m = s.mpki( e ); m )
+            sep() << perf_event_name( e ) << "/KI=" << *m;
+    out.flags( flags );
+    out.precision( prec );
+    return out;
+}
+
+#ifdef __linux__
+
+namespace {
+
+// perf_event_open has no glibc wrapper.
+int perf_open( uint32_t type, uint64_t config, int group_fd ) {
+    perf_event_attr attr{};
+    attr.size           = sizeof( attr );
+    attr.type           = type;
+    attr.config         = config;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv     = 1;
+    attr.read_format    = PERF_FORMAT_GROUP |
+                          PERF_FORMAT_TOTAL_TIME_ENABLED |
+                          PERF_FORMAT_TOTAL_TIME_RUNNING;
+    // This thread, any CPU.
+    return int( syscall( SYS_perf_event_open, &attr, 0, -1,
+                         group_fd, 0 ) );
+}
+
+struct EventConfig {
+    uint32_t type;
+    uint64_t config;
+};
+
+// In the order of PerfEvent.
+constexpr EventConfig event_configs[num_perf_events] = {
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES       },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS     },
+    { PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D |
+                          (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                          (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES     },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES    },
+};
+
+} // anonymous namespace
+
+PerfCounters::PerfCounters() : m_fds(), m_leader( -1 ) {
+    m_fds.fill( -1 );
+    for( size_t i = 0; i < num_perf_events; ++i ) {
+        auto const& c = event_configs[i];
+        m_fds[i] = perf_open( c.type, c.config, m_leader );
+        // If an event fails to open then just leave it out.
+        if( m_fds[i] >= 0 && m_leader < 0 )
+            m_leader = m_fds[i];
+    }
+    if( m_leader >= 0 ) {
+        ioctl( m_leader, PERF_EVENT_IOC_RESET,  PERF_IOC_FLAG_GROUP );
+        ioctl( m_leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP );
+    }
+}
+
+void PerfCounters::close_all() {
+    for( auto& fd : m_fds )
+        if( fd >= 0 ) {
+            close( fd );
+            fd = -1;
+        }
+    m_leader = -1;
+}
+
+PerfSample PerfCounters::read() const {
+    PerfSample res;
+    if( m_leader < 0 )
+        return res;
+    // Layout for PERF_FORMAT_GROUP with both times: nr, time_ena-
+    // bled, time_running, then one value per counter in the order
+    // in which they were added to the group.
+    uint64_t buf[3+num_perf_events] = {};
+    if( ::read( m_leader, buf, sizeof( buf ) ) < 0 )
+        return res;
+    uint64_t nr      = buf[0];
+    uint64_t enabled = buf[1];
+    uint64_t running = buf[2];
+    if( running == 0 )
+        return res;
+    double scale = double( enabled ) / double( running );
+    size_t j = 0;
+    for( size_t i = 0; i < num_perf_events && j < nr; ++i )
+        if( m_fds[i] >= 0 )
+            res.values[i] = uint64_t( double( buf[3+j++] )*scale );
+    return res;
+}
+
+#else
+
+PerfCounters::PerfCounters() : m_fds(), m_leader( -1 ) {
+    m_fds.fill( -1 );
+}
+
+void PerfCounters::close_all() {}
+
+PerfSample PerfCounters::read() const { return {}; }
+
+#endif
+
+PerfCounters::~PerfCounters() { close_all(); }
+
+PerfCounters::PerfCounters( PerfCounters&& rhs ) noexcept
+    : m_fds( rhs.m_fds ), m_leader( rhs.m_leader ) {
+    rhs.m_fds.fill( -1 );
+    rhs.m_leader = -1;
+}
+
+PerfCounters& PerfCounters::operator=( PerfCounters&& rhs ) noexcept {
+    if( this != &rhs ) {
+        close_all();
+        m_fds    = rhs.m_fds;
+        m_leader = rhs.m_leader;
+        rhs.m_fds.fill( -1 );
+        rhs.m_leader = -1;
+    }
+    return *this;
+}
+
+} // namespace util
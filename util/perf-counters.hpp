@@ -0,0 +1,89 @@
+/****************************************************************
+* Hardware performance counters
+****************************************************************/
+#pragma once
+
+#include "non-copyable.hpp"
+
+#include <array>
+#include <cstdint>
+#include <iostream>
+#include <optional>
+
+namespace util {
+
+enum class PerfEvent {
+    cycles,
+    instructions,
+    l1d_misses,    // L1 data cache read misses.
+    llc_misses,    // Last level cache misses.
+    branch_misses
+};
+
+constexpr size_t num_perf_events = 5;
+
+char const* perf_event_name( PerfEvent e );
+
+// Counter values; an event is nullopt if its counter couldn't be
+// opened.
+struct PerfSample {
+    std::array<std::optional<uint64_t>, num_perf_events> values;
+
+    std::optional<uint64_t> operator[]( PerfEvent e ) const
+        { return values[size_t( e )]; }
+
+    // Instructions per cycle.
+    std::optional<double> ipc() const;
+
+    // Misses (or other events) per thousand instructions.
+    std::optional<double> mpki( PerfEvent e ) const;
+};
+
+// Counts between two samples of the same counters.
+PerfSample operator-( PerfSample const& end, PerfSample const& start );
+
+// Prints the available counts and derived metrics, e.g.:
+// "cycles=1200 instructions=2400 ... IPC=2.00 L1D-misses/KI=1.50
+// ...", where X/KI is X per thousand instructions.
+std::ostream& operator<<( std::ostream& out, PerfSample const& s );
+
+/****************************************************************
+* PerfCounters
+*
+* A  group  of hardware counters for the calling thread, opened
+* with perf_event_open on Linux, counting from construction (in
+* user space only). Since they only count the thread that created
+* them, reads must be made on that thread.
+*
+* Access to the counters may be denied by the kernel (see  /proc/
+* sys/kernel/perf_event_paranoid),  unsupported by the CPU (e.g.
+* in  some  virtual  machines),  or  not available on the platform
+* at all. This is not an error: counters that can't be opened are
+* left out of samples, and if none can be opened then available()
+* is false and all samples are empty.
+****************************************************************/
+class PerfCounters : util::movable_only {
+
+public:
+    PerfCounters();
+    ~PerfCounters();
+
+    PerfCounters( PerfCounters&& rhs ) noexcept;
+    PerfCounters& operator=( PerfCounters&& rhs ) noexcept;
+
+    bool available() const { return m_leader >= 0; }
+
+    // Totals since construction, scaled to account for any time
+    // during which the kernel had to multiplex the counters.
+    PerfSample read() const;
+
+private:
+    void close_all();
+
+    // File descriptors, -1 for those that failed to open; the
+    // first one that opened leads the group.
+    std::array<int, num_perf_events> m_fds;
+    int                              m_leader;
+};
+
+} // namespace util
@@ -19,14 +19,34 @@ void StopWatch::start( string_view name ) {
     start_times[n] = clock_type::now();
     if( has_key( end_times, n ) )
         end_times.erase( n );
+    if constexpr( alloc_tracking_enabled ) {
+        alloc_ends.erase( n );
+        // Create the map entry before taking the snapshot so that
+        // its allocation is not counted.
+        auto& slot = alloc_starts[n];
+        slot = thread_alloc_stats();
+    }
+    // Read the counters last so as not to count the above.
+    if( perf_counters ) {
+        perf_ends.erase( n );
+        perf_starts[n] = perf_counters->read();
+    }
 }
 
 // Register an end time for an event. Will throw if there was  no
 // start time for the event.
 void StopWatch::stop( string_view name ) {
+    auto alloc_end = thread_alloc_stats();
     string n( name );
+    PerfSample perf_end;
+    if( perf_counters )
+        perf_end = perf_counters->read();
     ASSERT_( has_key( start_times, n ) );
     end_times[n] = clock_type::now();
+    if constexpr( alloc_tracking_enabled )
+        alloc_ends[n] = alloc_end;
+    if( perf_counters && has_key( perf_starts, n ) )
+        perf_ends[n] = perf_end;
 }
 
 // Get results for an even in the given units. If either a  start
@@ -96,6 +116,29 @@ vector<StopWatch::result_pair> StopWatch::results() const {
     return res;
 }
 
+bool StopWatch::enable_perf_counters() {
+    if( !perf_counters )
+        perf_counters = make_shared<PerfCounters>();
+    return perf_counters->available();
+}
+
+optional<PerfSample> StopWatch::perf( string_view name ) const {
+    ASSERT_( event_complete( name ) );
+    string n( name );
+    if( !perf_counters || !perf_counters->available() ||
+        !has_key( perf_ends, n ) )
+        return nullopt;
+    return perf_ends.at( n ) - perf_starts.at( n );
+}
+
+optional<AllocStats> StopWatch::allocs( string_view name ) const {
+    ASSERT_( event_complete( name ) );
+    string n( name );
+    if( !alloc_tracking_enabled || !has_key( alloc_ends, n ) )
+        return nullopt;
+    return alloc_ends.at( n ) - alloc_starts.at( n );
+}
+
 // Will simply check if an event is present in both the start and
 // end time sets, i.e., it is ready for computing results.
 bool StopWatch::event_complete( string_view name ) const {
@@ -3,9 +3,14 @@
 ****************************************************************/
 #pragma once
 
+#include "alloc-tracker.hpp"
+#include "perf-counters.hpp"
+
 #include <chrono>
 #include <iostream>
 #include <map>
+#include <memory>
+#include <optional>
 #include <string>
 #include <string_view>
 #include <vector>
@@ -47,6 +52,22 @@ public:
     using result_pair = std::pair<std::string, std::string>;
     std::vector<result_pair> results() const;
 
+    // Opt  in  to  also  recording hardware counters (cycles, in-
+    // structions, cache misses, etc.) for each event. They count
+    // the calling thread, so events must then be started and stop-
+    // ped on it. Returns false if no counters are available.
+    bool enable_perf_counters();
+
+    // Counts for a complete event, or nullopt if counters were not
+    // enabled or are not available.
+    std::optional<PerfSample> perf( std::string_view name ) const;
+
+    // Allocations made by the thread during a complete event, or
+    // nullopt unless built with TRACK_ALLOCATIONS (in which case
+    // they are always recorded). peak_live is not measured here;
+    // use AllocScope for that.
+    std::optional<AllocStats> allocs( std::string_view name ) const;
+
 private:
     using clock_type   = std::chrono::steady_clock;
     using time_point   = std::chrono::time_point<clock_type>;
@@ -57,6 +78,14 @@ private:
     events_timer start_times;
     events_timer end_times;
 
+    // Shared so that the watch remains copyable.
+    std::shared_ptr<PerfCounters>     perf_counters;
+    std::map<std::string, PerfSample> perf_starts;
+    std::map<std::string, PerfSample> perf_ends;
+
+    std::map<std::string, AllocStats> alloc_starts;
+    std::map<std::string, AllocStats> alloc_ends;
+
 };
 
 /* This is for convenience. Will  start a timer upon construction,
@@ -64,8 +93,14 @@ private:
 class ScopedWatch {
 
 public:
-    explicit ScopedWatch( std::string_view title )
-        : name( title ) { watch.start( name ); }
+    // If with_perf is true then hardware counters (if available)
+    // will also be printed.
+    explicit ScopedWatch( std::string_view title,
+                          bool             with_perf = false )
+        : name( title ) {
+        if( with_perf ) watch.enable_perf_counters();
+        watch.start( name );
+    }
 
     ScopedWatch( ScopedWatch const& ) = default;
     ScopedWatch( ScopedWatch&&      ) = default;
@@ -79,6 +114,10 @@ public:
         // grams that communicate their output via stdout.
         std::cerr << name << " time: " << watch.human( name )
                   << "\n";
+        if( auto perf = watch.perf( name ); perf )
+            std::cerr << name << " counters: " << *perf << "\n";
+        if( auto allocs = watch.allocs( name ); allocs )
+            std::cerr << name << " allocations: " << *allocs << "\n";
     }
 
 private:
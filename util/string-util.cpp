@@ -6,6 +6,10 @@
 #include "string-util.hpp"
 
 #include <algorithm>
+#include <cstdint>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
 
 using namespace std;
 
@@ -28,6 +32,111 @@ bool ends_with( string_view s, string_view w ) {
                      rbegin( w ), rend( w ) ).second == rend( w );
 }
 
+namespace {
+
+// These are used to operate on eight bytes at a time.
+constexpr uint64_t ones  = 0x0101010101010101ULL;
+constexpr uint64_t highs = 0x8080808080808080ULL;
+
+// Lowercases any ASCII letters among the eight bytes in the word,
+// which must all be <= 0x7F (so that no additions carry from one
+// byte  into  the next). For each byte, the high bit of ge_A will
+// be set if it is >= 'A' and the high bit of gt_Z will be set  if
+// it  is  > 'Z'; so their xor has the high bit set precisely for
+// the upper case letters, and shifting that  bit  down  gives  us
+// 0x20, which is the difference between upper and lower case.
+inline uint64_t fold_word( uint64_t w ) {
+    uint64_t ge_A  = w + ones*(0x80 - 'A');
+    uint64_t gt_Z  = w + ones*(0x80 - 'Z' - 1);
+    uint64_t upper = (ge_A ^ gt_Z) & highs;
+    return w | (upper >> 2);
+}
+
+inline unsigned char fold_byte( unsigned char c ) {
+    return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+}
+
+// Same as fold_word but works on words with bytes above 0x7F, by
+// leaving those bytes unchanged.
+inline uint64_t fold_word_slow( uint64_t w ) {
+    unsigned char bytes[sizeof( w )];
+    memcpy( bytes, &w, sizeof( w ) );
+    for( auto& b : bytes )
+        b = fold_byte( b );
+    memcpy( &w, bytes, sizeof( w ) );
+    return w;
+}
+
+inline uint64_t fold_any_word( uint64_t w ) {
+    return (w & highs) ? fold_word_slow( w ) : fold_word( w );
+}
+
+inline uint64_t load_word( char const* p ) {
+    uint64_t w;
+    memcpy( &w, p, sizeof( w ) );
+    return w;
+}
+
+} // anonymous namespace
+
+// Case-insensitive comparison of two char strings in which  only
+// the  ASCII  letters are case-folded; any bytes above 0x7F must
+// match exactly.
+bool ascii_iequals( string_view s1, string_view s2 ) {
+    if( s1.size() != s2.size() )
+        return false;
+    size_t const n = s1.size();
+    size_t i = 0;
+    for( ; i + sizeof( uint64_t ) <= n; i += sizeof( uint64_t ) ) {
+        auto w1 = load_word( s1.data()+i );
+        auto w2 = load_word( s2.data()+i );
+        if( w1 == w2 )
+            continue;
+        // Since  fold_byte leaves non-ASCII bytes alone this will
+        // require them to be equal.
+        if( fold_any_word( w1 ) != fold_any_word( w2 ) )
+            return false;
+    }
+    for( ; i < n; ++i )
+        if( fold_byte( s1[i] ) != fold_byte( s2[i] ) )
+            return false;
+    return true;
+}
+
+// Case-insensitive hash consistent with ascii_iequals. This is a
+// word-at-a-time  variant  of  FNV-1a  followed by a final mixing
+// step so that all bits of the input affect the result.
+size_t ascii_ihash( string_view s ) {
+    constexpr uint64_t prime = 0x100000001b3ULL;
+    uint64_t h = 0xcbf29ce484222325ULL ^ s.size();
+    size_t const n = s.size();
+    size_t i = 0;
+    for( ; i + sizeof( uint64_t ) <= n; i += sizeof( uint64_t ) )
+        h = (h ^ fold_any_word( load_word( s.data()+i ) )) * prime;
+    if( i < n ) {
+        uint64_t w = 0;
+        memcpy( &w, s.data()+i, n-i );
+        h = (h ^ fold_any_word( w )) * prime;
+    }
+    h ^= h >> 33; h *= 0xff51afd7ed558ccdULL; h ^= h >> 33;
+    return size_t( h );
+}
+
+size_t ihash::operator()( fs::path const& p ) const {
+    if constexpr( is_same_v<fs::path::string_type, string> )
+        return ascii_ihash( p.native() );
+    else
+        return ascii_ihash( p.string() );
+}
+
+bool iequal_to::operator()( fs::path const& l,
+                            fs::path const& r ) const {
+    if constexpr( is_same_v<fs::path::string_type, string> )
+        return ascii_iequals( l.native(), r.native() );
+    else
+        return ascii_iequals( l.string(), r.string() );
+}
+
 // Strip all blank space off of  a  string  view and return a new
 // one.
 string_view strip( string_view sv ) {
@@ -80,41 +189,132 @@ vector<string_view> split_strip( string_view sv, char c ) {
     return split_strip_any( sv, string_view( &c, 1 ) );
 }
 
+namespace {
+
+// Calls f on each word in the text, where words are separated by
+// any amount of space, tabs, or newlines.
+template<typename Func>
+void for_each_word( string_view text, Func f ) {
+    constexpr string_view spaces = " \n\r\t";
+    while( true ) {
+        auto start = text.find_first_not_of( spaces );
+        if( start == string_view::npos ) break;
+        text.remove_prefix( start );
+        auto end = min( text.find_first_of( spaces ), text.size() );
+        f( text.substr( 0, end ) );
+        text.remove_prefix( end );
+    }
+}
+
+} // anonymous namespace
+
+// This  is  the  adapter  that  keeps the original callback API
+// working: the callback must be given the entire candidate line,
+// so  we can't avoid re-measuring it, but we build the candidate
+// in place in a single buffer (appending the word and then trim-
+// ming it back off if it doesn't fit) rather than copying the  line
+// for every word.
 vector<string> wrap_text_fn( string_view text,
                              IsStrOkFunc const& is_ok ) {
-  auto words = util::split_strip_any( text, " \n\r\t" );
-  vector<string> res;
-  string line;
-  for( auto const& word : words ) {
-    string proposed;
-    proposed = line;
-    if( proposed.empty() )
-        proposed = word;
-    else
-        proposed += ' ' + string( word );
+    vector<string> res;
+    string line;
+    for_each_word( text, [&]( string_view word ) {
+        auto old_size = line.size();
+        if( !line.empty() )
+            line += ' ';
+        line += word;
 
-    if( is_ok( proposed ) ) {
-        line = proposed;
-    } else {
+        if( is_ok( line ) )
+            return;
+
+        line.resize( old_size );
         if( line.empty() )
             // word on its own line.
-            res.emplace_back( move( proposed ) );
+            res.emplace_back( word );
         else {
             // push current line and put new word on next line.
             res.emplace_back( move( line ) );
             line = word;
         }
-    }
-  }
-  if( !line.empty() )
-      res.emplace_back( move( line ) );
-  return res;
+    });
+    if( !line.empty() )
+        res.emplace_back( move( line ) );
+    return res;
 }
 
 vector<string> wrap_text( string_view text, int max_length ) {
-    return wrap_text_fn( text, [max_length]( string_view sv ) {
-        return int( sv.size() ) <= max_length;
+    TextWrapper wrapper;
+    auto const& lines = wrapper.wrap( text, max_length );
+    return vector<string>( lines.begin(), lines.end() );
+}
+
+template<typename WidthFunc>
+void TextWrapper::wrap_impl( string_view      text,
+                             int              max_width,
+                             WidthFunc const& width ) {
+    m_buf.clear();
+    m_spans.clear();
+    m_lines.clear();
+    // The output can never be longer than the input since runs of
+    // whitespace get replaced with single spaces or line breaks.
+    m_buf.reserve( text.size() );
+
+    size_t line_start = 0;
+    int    line_width = 0;
+    bool   in_line    = false;
+
+    auto end_line = [&] {
+        m_spans.emplace_back( line_start, m_buf.size() );
+        in_line = false;
+    };
+
+    auto start_line = [&]( string_view word ) {
+        line_start = m_buf.size();
+        m_buf += word;
+        line_width = width( word, true );
+        in_line    = true;
+        if( line_width > max_width )
+            // word on its own line.
+            end_line();
+    };
+
+    for_each_word( text, [&]( string_view word ) {
+        if( !in_line )
+            return start_line( word );
+        int extra = width( word, false );
+        if( line_width + extra <= max_width ) {
+            m_buf += ' ';
+            m_buf += word;
+            line_width += extra;
+            return;
+        }
+        end_line();
+        start_line( word );
     });
+    if( in_line )
+        end_line();
+
+    // Only  take  the views once the buffer has stopped changing.
+    m_lines.reserve( m_spans.size() );
+    for( auto [l, r] : m_spans )
+        m_lines.emplace_back( m_buf.data()+l, r-l );
+}
+
+vector<string_view> const& TextWrapper::wrap(
+        string_view          text,
+        int                  max_width,
+        WordWidthFunc const& width ) {
+    wrap_impl( text, max_width, width );
+    return m_lines;
+}
+
+vector<string_view> const& TextWrapper::wrap( string_view text,
+                                              int max_width ) {
+    auto width = []( string_view word, bool first ) {
+        return int( word.size() ) + (first ? 0 : 1);
+    };
+    wrap_impl( text, max_width, width );
+    return m_lines;
 }
 
 // Convert element type.
@@ -217,20 +417,116 @@ string to_string( ZonedTimePoint const& p ) {
     return util::fmt_time( p, util::tz_utc() );
 }
 
+/****************************************************************
+* Format-To utilities
+****************************************************************/
+size_t estimate_size( char )                { return 3; }
+size_t estimate_size( char const* s )       { return strlen( s )+2; }
+size_t estimate_size( string const& s )     { return s.size()+2; }
+size_t estimate_size( string_view s )       { return s.size()+2; }
+size_t estimate_size( fs::path const& p ) {
+    return p.native().size()+2;
+}
+
+// NOTE: This puts single quotes around the character!
+void format_to( FmtBuffer& buf, char c ) {
+    buf += '\'';
+    buf += c;
+    buf += '\'';
+}
+
+// NOTE: These put quotes around the string! See the note on  the
+// corresponding to_string overloads for the reason.
+void format_to( FmtBuffer& buf, string_view s ) {
+    buf += '"';
+    buf += s;
+    buf += '"';
+}
+
+void format_to( FmtBuffer& buf, char const* s ) {
+    format_to( buf, string_view( s ) );
+}
+
+void format_to( FmtBuffer& buf, string const& s ) {
+    format_to( buf, string_view( s ) );
+}
+
+// Will convert the path  to  a  std::string  and put quotes around
+// it, just as the to_string overload does. On platforms where the
+// path is already stored as a std::string we avoid the copy.
+void format_to( FmtBuffer& buf, fs::path const& p ) {
+    if constexpr( is_same_v<fs::path::string_type, string> )
+        format_to( buf, string_view( p.native() ) );
+    else
+        format_to( buf, string_view( p.string() ) );
+}
+
 /****************************************************************
 * From-String utilities
 ****************************************************************/
 
+namespace {
+
+// Where the standard library supports  it  we  use  from_chars,
+// which  is locale-independent and does not allocate. Otherwise
+// we fall back to the strto* family, which needs a null-termina-
+// ted string and so we copy it onto the stack when it fits.
+template<typename T, typename StrToFunc>
+bool parse_floating_impl( string_view sv, T& out, StrToFunc f ) {
+    if( sv.empty() || sv[0] == '+' ||
+        isspace( static_cast<unsigned char>( sv[0] ) ) )
+        return false;
+#if defined( __cpp_lib_to_chars )
+    (void)f;
+    auto [ptr, ec] = from_chars( sv.data(), sv.data()+sv.size(),
+                                 out );
+    return ec == errc() && ptr == sv.data()+sv.size();
+#else
+    constexpr size_t max_stack{64};
+    char buf[max_stack];
+    string heap;
+    char const* s = buf;
+    if( sv.size() < max_stack ) {
+        copy( sv.begin(), sv.end(), buf );
+        buf[sv.size()] = 0;
+    } else {
+        heap = string( sv );
+        s = heap.c_str();
+    }
+    char* end = nullptr;
+    errno = 0;
+    out = f( s, &end );
+    return errno == 0 && end == s+sv.size();
+#endif
+}
+
+} // anonymous namespace
+
+// Implementation  of  util::parse  for the floating point types.
+bool parse_floating( string_view sv, float& out ) {
+    return parse_floating_impl( sv, out, []( char const* s,
+        char** e ){ return strtof( s, e ); } );
+}
+
+bool parse_floating( string_view sv, double& out ) {
+    return parse_floating_impl( sv, out, []( char const* s,
+        char** e ){ return strtod( s, e ); } );
+}
+
+bool parse_floating( string_view sv, long double& out ) {
+    return parse_floating_impl( sv, out, []( char const* s,
+        char** e ){ return strtold( s, e ); } );
+}
+
 // This is to replace std::stoi -- it will enforce that the input
 // string is not empty and  that  the parsing consumes the entire
 // string.
-int stoi( string const& s, int base ) {
+int stoi( string_view s, int base ) {
     ASSERT( !s.empty(), "cannot convert empty string to int" );
-    size_t written;
-    auto res = stoi( s, &written, base );
-    ASSERT( written == s.size(), "failed to parse entire string "
+    auto res = parse<int>( s, base );
+    ASSERT( res, "failed to parse entire string "
             << quoted( s ) << " into an integer." );
-    return res;
+    return *res;
 }
 
 } // namespace util
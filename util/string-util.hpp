@@ -9,11 +9,14 @@
 #include "types.hpp"
 
 #include <cctype>
+#include <charconv>
 #include <experimental/filesystem>
+#include <limits>
 #include <optional>
 #include <string>
 #include <string_view>
 #include <tuple>
+#include <type_traits>
 #include <utility>
 #include <variant>
 #include <vector>
@@ -31,10 +34,27 @@ bool starts_with( std::string_view s, std::string_view what );
 // Returns true if s ends with what.
 bool ends_with( std::string_view s, std::string_view what );
 
+// Case-insensitive comparison of two char strings in which  only
+// the  ASCII  letters are case-folded; any bytes above 0x7F must
+// match exactly. This does not consult the locale and  it  com-
+// pares eight bytes at a time, dropping to a byte-by-byte compar-
+// ison only for words that contain non-ASCII bytes.
+bool ascii_iequals( std::string_view s1, std::string_view s2 );
+
+// Case-insensitive hash consistent with ascii_iequals, i.e.,  two
+// strings  that  compare equal under ascii_iequals will have the
+// same hash.
+size_t ascii_ihash( std::string_view s );
+
 // Case-insensitive comparison. This is intended to work for both
-// char strings and wchar strings.
+// char strings and wchar strings. char strings are dispatched to
+// ascii_iequals.
 template<typename StringT>
 bool iequals( StringT const& s1, StringT const& s2 ) {
+    if constexpr( std::is_convertible_v<StringT const&,
+                                        std::string_view> )
+        return ascii_iequals( s1, s2 );
+
     // This check is for efficiency.
     if( s1.size() != s2.size() )
         return false;
@@ -56,6 +76,40 @@ bool iequals( StringT const& s1, StringT const& s2 ) {
                        predicate );
 }
 
+// Hash and equality functors for  case-insensitive  unordered  con-
+// tainers, e.g.:
+//
+//   unordered_map<fs::path, int, util::ihash, util::iequal_to>
+//
+// These  follow ascii_iequals/ascii_ihash and so no lowercased copies
+// of  the  keys  are  made. Note that for paths they operate on the
+// string representation of the path, so paths should be normalized
+// beforehand  (e.g.  with lexically_normal) if A//B and A/B are to
+// be considered equal.
+struct ihash {
+    size_t operator()( std::string_view s ) const noexcept
+        { return ascii_ihash( s ); }
+    size_t operator()( std::string const& s ) const noexcept
+        { return ascii_ihash( s ); }
+    size_t operator()( char const* s ) const noexcept
+        { return ascii_ihash( s ); }
+    size_t operator()( fs::path const& p ) const;
+};
+
+struct iequal_to {
+    bool operator()( std::string_view l,
+                     std::string_view r ) const noexcept
+        { return ascii_iequals( l, r ); }
+    bool operator()( std::string const& l,
+                     std::string const& r ) const noexcept
+        { return ascii_iequals( l, r ); }
+    bool operator()( char const* l,
+                     char const* r ) const noexcept
+        { return ascii_iequals( l, r ); }
+    bool operator()( fs::path const& l,
+                     fs::path const& r ) const;
+};
+
 // This  will  intersperse  `what` into the vector of strings and
 // join the result. It  will  attempt  to compute require reserve
 // space before hand to minimize memory allocations.
@@ -136,6 +190,58 @@ std::vector<std::string> wrap_text_fn( std::string_view text,
 std::vector<std::string> wrap_text( std::string_view text,
                                     int max_length );
 
+// This  is  the  callback  used by the TextWrapper to measure text
+// incrementally.  It  is  given  a word and a flag indicating whe-
+// ther the word would be the first one on its line, and  it  must
+// return  the width that appending the word to the line would add
+// to  it,  including the width of the separating space if the word
+// is not the first. The width of a line is taken to be the sum of
+// the widths reported for each of its words.
+using WordWidthFunc = std::function<int( std::string_view word,
+                                         bool first )>;
+
+/****************************************************************
+* TextWrapper
+*
+* Linear-time  text  wrapping engine. Unlike wrap_text_fn, which
+* must re-measure the entire candidate line each time a  word  is
+* added,  this  measures  each  word  only once (via a WordWidth-
+* Func) and keeps a running total of the line width. The  result-
+* ing lines are written into a buffer owned by the wrapper which
+* is reused from one call to the next, so a single  wrapper  can
+* be used to wrap many texts with very little allocation.
+*
+* Wrapping  rules  are  the  same as for wrap_text_fn: words are
+* separated by any amount of whitespace in the input and by  sin-
+* gle spaces in the output, and a word that is too wide to fit on
+* any line is put on a line of its own.
+****************************************************************/
+class TextWrapper {
+
+public:
+    // The  returned  views point into the wrapper's buffer and are
+    // only valid until the next call to wrap().
+    std::vector<std::string_view> const& wrap(
+            std::string_view     text,
+            int                  max_width,
+            WordWidthFunc const& width );
+
+    // Same  as  above  but  the  width of a word is its number of
+    // chars and the width of a space is one.
+    std::vector<std::string_view> const& wrap(
+            std::string_view text,
+            int              max_width );
+
+private:
+    template<typename WidthFunc>
+    void wrap_impl( std::string_view text, int max_width,
+                    WidthFunc const& width );
+
+    std::string                   m_buf;
+    PairVec<size_t, size_t>       m_spans;
+    std::vector<std::string_view> m_lines;
+};
+
 // Convert element type.
 std::vector<std::string>
 to_strings( std::vector<std::string_view> const& svs );
@@ -218,27 +324,6 @@ std::string to_string( std::optional<T> const& opt );
 template<typename... Args>
 std::string to_string( std::tuple<Args...> const& tp );
 
-// This function exists for the purpose of  having  the  compiler
-// deduce the Indexes variadic integer arguments that we can then
-// use to index the tuple; it probably is not useful to call this
-// method  directly  (it is called by to_string). Was not able to
-// find a more elegant way of unpacking an arbitrary tuple passed
-// in as an argument apart from using  this  helper  function  in-
-// volving the index_sequence.
-template<typename Tuple, size_t... Indexes>
-StrVec tuple_elems_to_string(
-        Tuple const& tp,
-        std::index_sequence<Indexes...> /*unused*/ );
-
-// This function exists for the purpose of  having  the  compiler
-// deduce the Indexes variadic integer arguments that we can then
-// use  to  index  the variant; it probably is not useful to call
-// this method directly (it is called by to_string).
-template<typename Variant, size_t... Indexes>
-std::string variant_elems_to_string(
-        Variant const& v,
-        std::index_sequence<Indexes...> /*unused*/ );
-
 template<typename... Args>
 std::string to_string( std::variant<Args...> const& v );
 
@@ -271,6 +356,127 @@ std::string to_string( SysTimePoint const& p );
 template<>
 std::string to_string( ZonedTimePoint const& p );
 
+/****************************************************************
+* Format-To utilities
+*
+* util::format_to  family of overloaded functions produce exactly
+* the same output as the corresponding util::to_string overloads,
+* but  instead  of  returning a new string they append the result
+* onto the end of a caller-supplied buffer. This way a  container
+* of  containers  (e.g.  a vector of tuples) can be serialized in
+* one pass into a single growable buffer without creating  a  tem-
+* porary  string  (and  a vector of them) for each element. The
+* to_string overloads for containers are thin wrappers  around
+* these  which  first reserve space using estimate_size.
+*
+* For leaf types that don't have their own format_to overload the
+* default  version  will  format  integers  in place and will fall
+* back to util::to_string for anything else,  so  that  any  user-
+* supplied  specializations  of util::to_string are respected.
+****************************************************************/
+// This is the buffer type that format_to appends to.
+using FmtBuffer = std::string;
+
+// Returns an estimate of the number of characters that format_to
+// will append for the given object. It does not need to be exact
+// since it is only used to reserve  space  up front, but it should
+// be  cheap  and  should  try  not to underestimate for the common
+// types.
+template<typename T>
+size_t estimate_size( T const& arg );
+
+size_t estimate_size( char c );
+size_t estimate_size( char const* s );
+size_t estimate_size( std::string const& s );
+size_t estimate_size( std::string_view s );
+size_t estimate_size( fs::path const& p );
+
+template<typename T>
+size_t estimate_size( Ref<T> const& rw );
+
+template<typename T>
+size_t estimate_size( CRef<T> const& rw );
+
+template<typename T>
+size_t estimate_size( std::optional<T> const& opt );
+
+template<typename... Args>
+size_t estimate_size( std::tuple<Args...> const& tp );
+
+template<typename... Args>
+size_t estimate_size( std::variant<Args...> const& v );
+
+template<typename U, typename V>
+size_t estimate_size( std::pair<U, V> const& p );
+
+template<typename T>
+size_t estimate_size( std::vector<T> const& v );
+
+// Default  version  formats  integers  in place and otherwise dele-
+// gates to util::to_string.
+template<typename T>
+void format_to( FmtBuffer& buf, T const& arg );
+
+// These all follow the  same  quoting  conventions  as  their  to_-
+// string counterparts.
+void format_to( FmtBuffer& buf, char c );
+void format_to( FmtBuffer& buf, char const* s );
+void format_to( FmtBuffer& buf, std::string const& s );
+void format_to( FmtBuffer& buf, std::string_view s );
+void format_to( FmtBuffer& buf, fs::path const& p );
+
+template<typename T>
+void format_to( FmtBuffer& buf, Ref<T> const& rw );
+
+template<typename T>
+void format_to( FmtBuffer& buf, CRef<T> const& rw );
+
+template<typename T>
+void format_to( FmtBuffer& buf, std::optional<T> const& opt );
+
+// Will do JSON-like notation. E.g. (1,2,3)
+template<typename... Args>
+void format_to( FmtBuffer& buf, std::tuple<Args...> const& tp );
+
+// This function exists for the purpose of  having  the  compiler
+// deduce the Indexes variadic integer arguments that we can then
+// use to index the tuple; it probably is not useful to call this
+// method  directly  (it is called by format_to). Was not able to
+// find a more elegant way of unpacking an arbitrary tuple passed
+// in as an argument apart from using  this  helper  function  in-
+// volving the index_sequence.
+template<typename Tuple, size_t... Indexes>
+void tuple_elems_format_to(
+        FmtBuffer&   buf,
+        Tuple const& tp,
+        std::index_sequence<Indexes...> /*unused*/ );
+
+// This function exists for the purpose of  having  the  compiler
+// deduce the Indexes variadic integer arguments that we can then
+// use  to  index  the variant; it probably is not useful to call
+// this method directly (it is called by format_to).
+template<typename Variant, size_t... Indexes>
+void variant_elems_format_to(
+        FmtBuffer&     buf,
+        Variant const& v,
+        std::index_sequence<Indexes...> /*unused*/ );
+
+template<typename... Args>
+void format_to( FmtBuffer& buf, std::variant<Args...> const& v );
+
+// Will do JSON-like notation. E.g. (1,"hello")
+template<typename U, typename V>
+void format_to( FmtBuffer& buf, std::pair<U, V> const& p );
+
+// Prints in JSON style notation. E.g. [1,2,3]
+template<typename T>
+void format_to( FmtBuffer& buf, std::vector<T> const& v );
+
+// Reserves  space  according  to estimate_size and then formats
+// the object into a new string in a single pass.
+template<typename T>
+std::string format_to_string( T const& arg );
+
 template<typename T>
 std::ostream& operator<<( std::ostream&         out,
                           std::vector<T> const& v );
@@ -285,10 +491,41 @@ std::ostream& operator<<( std::ostream&          out,
 
 constexpr int default_base{10}; // base 10 is decimal
 
+// True for the types that util::parse supports, namely all of the
+// integral types (except bool and the character types) and all of
+// the floating point types.
+template<typename T>
+constexpr bool is_parsable_v =
+    (std::is_integral_v<T>         &&
+    !std::is_same_v<T, bool>       &&
+    !std::is_same_v<T, char>       &&
+    !std::is_same_v<T, wchar_t>    &&
+    !std::is_same_v<T, char16_t>   &&
+    !std::is_same_v<T, char32_t>)  ||
+     std::is_floating_point_v<T>;
+
+// Parse the entire string as a number of type T. Will return nul-
+// lopt  if  the  string  is empty, if the number does not fit in
+// the type, or if the parse does not consume the  entire  string.
+// Unlike std::stoi and friends, leading whitespace and a leading
+// `+` are not accepted. This function never throws and never  al-
+// locates,  so it is suitable for use in tight loops. The base is
+// ignored for floating point types.
+template<typename T>
+std::optional<T> parse( std::string_view sv,
+                        int base = default_base );
+
+// Implementation  of  util::parse  for the floating point types;
+// these are not meant to be called directly.
+bool parse_floating( std::string_view sv, float&       out );
+bool parse_floating( std::string_view sv, double&      out );
+bool parse_floating( std::string_view sv, long double& out );
+
 // This is to replace std::stoi -- it will enforce that the input
 // string is not empty and  that  the parsing consumes the entire
-// string.
-int stoi( std::string const& s, int base = default_base );
+// string. Throws on failure; see util::parse for a variant  that
+// does not throw.
+int stoi( std::string_view s, int base = default_base );
 
 } // namespace util
 
@@ -36,81 +36,251 @@ std::string to_string( CRef<T> const& rw ) {
 
 template<typename T>
 std::string to_string( std::optional<T> const& opt ) {
-    return opt ? util::to_string( *opt )
-               : std::string( "nullopt" );
+    return util::format_to_string( opt );
+}
+
+// Will do JSON-like notation. E.g. (1,2,3)
+template<typename... Args>
+std::string to_string( std::tuple<Args...> const& tp ) {
+    return util::format_to_string( tp );
+}
+
+template<typename... Args>
+std::string to_string( std::variant<Args...> const& v ) {
+    return util::format_to_string( v );
+}
+
+// Will do JSON-like notation. E.g. (1,"hello")
+template<typename U, typename V>
+std::string to_string( std::pair<U, V> const& p ) {
+    return util::format_to_string( p );
+}
+
+// Prints in JSON style notation. E.g. [1,2,3]
+template<typename T>
+std::string to_string( std::vector<T> const& v ) {
+    return util::format_to_string( v );
+}
+
+// Default  version uses std::to_string which is only defined for
+// a few primitive types.
+template<typename T>
+std::string to_string( T const& arg ) {
+    return std::to_string( arg );
+}
+
+/****************************************************************
+* Format-To utilities
+****************************************************************/
+namespace impl {
+
+// Integral types that can be formatted with std::to_chars, which
+// produces the same output as std::to_string for them. bool is ex-
+// cluded  because to_chars does not accept it, and the wide char
+// types are excluded because std::to_string does not treat  them
+// as integers either.
+template<typename T>
+constexpr bool is_to_chars_int_v =
+        std::is_integral_v<T>          &&
+       !std::is_same_v<T, bool>        &&
+       !std::is_same_v<T, wchar_t>     &&
+       !std::is_same_v<T, char16_t>    &&
+       !std::is_same_v<T, char32_t>;
+
+} // namespace impl
+
+template<typename T>
+size_t estimate_size( T const& ) {
+    if constexpr( impl::is_to_chars_int_v<T> )
+        // Max number of digits plus sign.
+        return std::numeric_limits<T>::digits10 + 2;
+    else
+        // Doubles formatted by std::to_string have six digits after
+        // the decimal point, and for anything else we just guess.
+        return 16;
+}
+
+template<typename T>
+size_t estimate_size( Ref<T> const& rw ) {
+    return util::estimate_size( rw.get() );
+}
+
+template<typename T>
+size_t estimate_size( CRef<T> const& rw ) {
+    return util::estimate_size( rw.get() );
+}
+
+template<typename T>
+size_t estimate_size( std::optional<T> const& opt ) {
+    return opt ? util::estimate_size( *opt )
+               : std::string_view( "nullopt" ).size();
+}
+
+template<typename... Args>
+size_t estimate_size( std::tuple<Args...> const& tp ) {
+    // Parenthesis plus one comma per element (one too many, but
+    // that's fine).
+    return std::apply( []( auto const&... args ){
+        return size_t( 2 + sizeof...( Args ) ) + (size_t( 0 ) + ... +
+               util::estimate_size( args ));
+    }, tp );
+}
+
+template<typename... Args>
+size_t estimate_size( std::variant<Args...> const& v ) {
+    return std::visit( []( auto const& e ){
+        return util::estimate_size( e );
+    }, v );
+}
+
+template<typename U, typename V>
+size_t estimate_size( std::pair<U, V> const& p ) {
+    return 3 + util::estimate_size( p.first  )
+             + util::estimate_size( p.second );
+}
+
+template<typename T>
+size_t estimate_size( std::vector<T> const& v ) {
+    // Brackets plus one comma per element.
+    size_t total = 2 + v.size();
+    for( auto const& e : v )
+        total += util::estimate_size( e );
+    return total;
+}
+
+// Default  version  formats  integers  in place and otherwise dele-
+// gates  to  util::to_string,  which  means  that  any  user  spe-
+// cializations of util::to_string will be picked up here.
+template<typename T>
+void format_to( FmtBuffer& buf, T const& arg ) {
+    if constexpr( impl::is_to_chars_int_v<T> ) {
+        char tmp[std::numeric_limits<T>::digits10 + 2];
+        auto res = std::to_chars( std::begin( tmp ),
+                                  std::end( tmp ), arg );
+        buf.append( tmp, res.ptr );
+    } else
+        buf += util::to_string( arg );
+}
+
+// Simply delegate to the wrapped type.
+template<typename T>
+void format_to( FmtBuffer& buf, Ref<T> const& rw ) {
+    util::format_to( buf, rw.get() );
+}
+
+// Not  sure if this one is also needed, but doesn't seem to hurt.
+template<typename T>
+void format_to( FmtBuffer& buf, CRef<T> const& rw ) {
+    util::format_to( buf, rw.get() );
+}
+
+template<typename T>
+void format_to( FmtBuffer& buf, std::optional<T> const& opt ) {
+    if( opt )
+        util::format_to( buf, *opt );
+    else
+        buf += "nullopt";
 }
 
 // This function exists for the purpose of  having  the  compiler
 // deduce the Indexes variadic integer arguments that we can then
 // use to index the tuple; it probably is not useful to call this
-// method  directly  (it is called by to_string). Was not able to
+// method  directly  (it is called by format_to). Was not able to
 // find a more elegant way of unpacking an arbitrary tuple passed
 // in as an argument apart from using  this  helper  function  in-
 // volving the index_sequence.
 template<typename Tuple, size_t... Indexes>
-StrVec tuple_elems_to_string( Tuple const& tp,
-                              std::index_sequence<Indexes...> ) {
-    StrVec res; res.reserve( std::tuple_size_v<Tuple> );
-    // Unary right fold of template parameter pack.
-    ((res.push_back( util::to_string( std::get<Indexes>( tp ) ))), ...);
-    return res;
+void tuple_elems_format_to( FmtBuffer&   buf,
+                            Tuple const& tp,
+                            std::index_sequence<Indexes...> ) {
+    // Unary right fold of template parameter pack. Each  element
+    // except the first is preceded by a comma.
+    ((buf.append( Indexes == 0 ? 0 : 1, ',' ),
+      util::format_to( buf, std::get<Indexes>( tp ) )), ...);
 }
 
 // Will do JSON-like notation. E.g. (1,2,3)
 template<typename... Args>
-std::string to_string( std::tuple<Args...> const& tp ) {
+void format_to( FmtBuffer& buf, std::tuple<Args...> const& tp ) {
     auto is = std::make_index_sequence<sizeof...(Args)>();
-    auto v = tuple_elems_to_string( tp, is );
-    return "(" + join( v, "," ) + ")";
+    buf += '(';
+    tuple_elems_format_to( buf, tp, is );
+    buf += ')';
 }
 
 // This function exists for the purpose of  having  the  compiler
 // deduce the Indexes variadic integer arguments that we can then
 // use  to  index  the variant; it probably is not useful to call
-// this method directly (it is called by to_string).
+// this method directly (it is called by format_to).
 template<typename Variant, size_t... Indexes>
-std::string variant_elems_to_string(
-        Variant const& v,
-        std::index_sequence<Indexes...> ) {
-    std::string res;
+void variant_elems_format_to( FmtBuffer&     buf,
+                              Variant const& v,
+                              std::index_sequence<Indexes...> ) {
     // Unary right fold of template parameter pack.
-    (( res += (Indexes == v.index())
-            ? util::to_string( std::get<Indexes>( v ) ) : ""
+    (( (Indexes == v.index())
+        ? util::format_to( buf, std::get<Indexes>( v ) ) : void()
     ), ...);
-    return res;
 }
 
 template<typename... Args>
-std::string to_string( std::variant<Args...> const& v ) {
+void format_to( FmtBuffer& buf, std::variant<Args...> const& v ) {
     auto is = std::make_index_sequence<sizeof...(Args)>();
-    return variant_elems_to_string( v, is );
+    variant_elems_format_to( buf, v, is );
 }
 
 // Will do JSON-like notation. E.g. (1,"hello")
 template<typename U, typename V>
-std::string to_string( std::pair<U, V> const& p ) {
-    return "(" + util::to_string( p.first )  + ","
-               + util::to_string( p.second ) + ")";
+void format_to( FmtBuffer& buf, std::pair<U, V> const& p ) {
+    buf += '(';
+    util::format_to( buf, p.first );
+    buf += ',';
+    util::format_to( buf, p.second );
+    buf += ')';
 }
 
 // Prints in JSON style notation. E.g. [1,2,3]
 template<typename T>
-std::string to_string( std::vector<T> const& v ) {
+void format_to( FmtBuffer& buf, std::vector<T> const& v ) {
+    buf += '[';
+    bool first = true;
+    for( auto const& e : v ) {
+        if( !first )
+            buf += ',';
+        util::format_to( buf, e );
+        first = false;
+    }
+    buf += ']';
+}
 
-    std::vector<std::string> res( v.size() );
-    // We  need  this lambda to help std::transform with overload
-    // resolution of to_string.
-    auto f = []( T const& e ){ return util::to_string( e ); };
-    std::transform( std::begin( v   ), std::end( v ),
-                    std::begin( res ), f );
-    return "[" + join( res, "," ) + "]";
+// Reserves  space  according  to estimate_size and then formats
+// the object into a new string in a single pass.
+template<typename T>
+std::string format_to_string( T const& arg ) {
+    std::string res;
+    res.reserve( util::estimate_size( arg ) );
+    util::format_to( res, arg );
+    return res;
 }
 
-// Default  version uses std::to_string which is only defined for
-// a few primitive types.
+/****************************************************************
+* From-String utilities
+****************************************************************/
 template<typename T>
-std::string to_string( T const& arg ) {
-    return std::to_string( arg );
+std::optional<T> parse( std::string_view sv, int base ) {
+    static_assert( is_parsable_v<T>,
+                  "util::parse does not support this type" );
+    T res{};
+    if constexpr( std::is_integral_v<T> ) {
+        auto [ptr, ec] = std::from_chars(
+                sv.data(), sv.data()+sv.size(), res, base );
+        if( ec != std::errc() || ptr != sv.data()+sv.size() )
+            return std::nullopt;
+    } else {
+        (void)base;
+        if( !parse_floating( sv, res ) )
+            return std::nullopt;
+    }
+    return res;
 }
 
 template<typename T>
@@ -0,0 +1,199 @@
+/****************************************************************
+* Low-overhead event tracing
+****************************************************************/
+#include "trace.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+
+using namespace std;
+
+namespace util::trace {
+
+namespace {
+
+// Events per thread; must be a power of two.
+constexpr size_t ring_size = 1 << 14;
+
+struct Record {
+    char const* name;
+    uint64_t    start_ns;
+    uint64_t    dur_ns;
+    bool        instant;
+};
+
+// Single-producer  single-consumer  ring:  only the owning thread
+// writes records and advances head, and only drain (one at a time,
+// under the registry lock) reads them and advances tail.
+struct Ring {
+    explicit Ring( uint32_t id )
+        : tid( id ), records( ring_size ), dead( false ), head( 0 ),
+          tail( 0 ) {}
+
+    uint32_t               tid;
+    vector<Record>         records;
+    // Set when the owning thread exits, after its last write.
+    atomic<bool>           dead;
+    // On separate cache lines so that the producer and  consumer
+    // don't contend.
+    alignas( 64 ) atomic<uint64_t> head;
+    alignas( 64 ) atomic<uint64_t> tail;
+};
+
+struct Registry {
+    mutex                   mtx;
+    // Rings  are  kept  here  after  their  threads exit so that
+    // their events can still be drained, and then erased by drain.
+    vector<shared_ptr<Ring>> rings;
+    uint32_t                next_tid{ 0 };
+    atomic<uint64_t>        dropped{ 0 };
+};
+
+Registry& registry() {
+    static Registry r;
+    return r;
+}
+
+// Marks the ring dead when its thread exits so that drain can free
+// it; otherwise every short-lived thread (e.g. those started by
+// par::for_each) would leave a full-sized ring behind.
+struct RingOwner {
+    shared_ptr<Ring> ring;
+
+    RingOwner() {
+        auto& r = registry();
+        lock_guard<mutex> lock( r.mtx );
+        ring = make_shared<Ring>( r.next_tid++ );
+        r.rings.push_back( ring );
+    }
+
+    ~RingOwner() { ring->dead.store( true, memory_order_release ); }
+};
+
+Ring& this_ring() {
+    thread_local RingOwner owner;
+    return *owner.ring;
+}
+
+void push( Record const& rec ) {
+    Ring& r = this_ring();
+    uint64_t h = r.head.load( memory_order_relaxed );
+    if( h - r.tail.load( memory_order_acquire ) == ring_size ) {
+        registry().dropped.fetch_add( 1, memory_order_relaxed );
+        return;
+    }
+    r.records[h & (ring_size-1)] = rec;
+    r.head.store( h+1, memory_order_release );
+}
+
+void write_json_str( ostream& out, string_view s ) {
+    out << '"';
+    for( char c : s ) {
+        if( c == '"' || c == '\\' )
+            out << '\\' << c;
+        else if( (unsigned char)c < 0x20 )
+            out << "\\u" << hex << setw( 4 ) << setfill( '0' )
+                << int( c ) << dec;
+        else
+            out << c;
+    }
+    out << '"';
+}
+
+// Chrome wants microseconds; keep the nanoseconds as decimals.
+void write_us( ostream& out, uint64_t ns ) {
+    out << ns/1000 << '.' << setw( 3 ) << setfill( '0' )
+        << ns%1000;
+}
+
+} // anonymous namespace
+
+uint64_t now_ns() {
+    return uint64_t( chrono::duration_cast<chrono::nanoseconds>(
+        chrono::steady_clock::now().time_since_epoch() ).count() );
+}
+
+void record( char const* name, uint64_t start_ns, uint64_t end_ns ) {
+    push( Record{ name, start_ns, end_ns-start_ns, false } );
+}
+
+void instant( char const* name ) {
+    push( Record{ name, now_ns(), 0, true } );
+}
+
+vector<Event> drain() {
+    vector<Event> res;
+    auto& reg = registry();
+    {
+        lock_guard<mutex> lock( reg.mtx );
+        for( auto& r : reg.rings ) {
+            // Checked first: if the thread is dead then head below
+            // is its final value and the ring can go once drained.
+            bool     dead = r->dead.load( memory_order_acquire );
+            uint64_t t    = r->tail.load( memory_order_relaxed );
+            uint64_t h    = r->head.load( memory_order_acquire );
+            for( ; t != h; ++t ) {
+                auto const& rec = r->records[t & (ring_size-1)];
+                res.push_back( Event{ rec.name, rec.start_ns,
+                    rec.dur_ns, r->tid, rec.instant } );
+            }
+            r->tail.store( h, memory_order_release );
+            if( dead ) r.reset();
+        }
+        reg.rings.erase( remove( reg.rings.begin(), reg.rings.end(),
+                                 nullptr ), reg.rings.end() );
+    }
+    sort( res.begin(), res.end(), []( auto const& l, auto const& r ){
+        return l.start_ns < r.start_ns;
+    });
+    return res;
+}
+
+uint64_t dropped() {
+    return registry().dropped.load( memory_order_relaxed );
+}
+
+size_t num_rings() {
+    auto& reg = registry();
+    lock_guard<mutex> lock( reg.mtx );
+    return reg.rings.size();
+}
+
+void write_chrome_json( ostream& out, vector<Event> const& events ) {
+    // Times are written relative to the first event to keep  the
+    // numbers short.
+    uint64_t base = events.empty() ? 0 : events[0].start_ns;
+    for( auto const& e : events )
+        base = min( base, e.start_ns );
+
+    out << "{\"traceEvents\":[";
+    bool first = true;
+    for( auto const& e : events ) {
+        out << (first ? "\n" : ",\n") << "{\"name\":";
+        first = false;
+        write_json_str( out, e.name );
+        out << ",\"ph\":\"" << (e.instant ? "i" : "X") << "\",\"ts\":";
+        write_us( out, e.start_ns-base );
+        if( e.instant )
+            out << ",\"s\":\"t\"";
+        else {
+            out << ",\"dur\":";
+            write_us( out, e.dur_ns );
+        }
+        out << ",\"pid\":1,\"tid\":" << e.tid << "}";
+    }
+    out << "\n],\"displayTimeUnit\":\"ns\"}\n";
+}
+
+void write_chrome_json( fs::path const& p ) {
+    ofstream out( p );
+    ASSERT( out.good(), "failed to open " << p << " for writing" );
+    write_chrome_json( out, drain() );
+}
+
+} // namespace util::trace
@@ -0,0 +1,119 @@
+/****************************************************************
+* Low-overhead event tracing
+****************************************************************/
+#pragma once
+
+#include "fs.hpp"
+#include "macros.hpp"
+
+#include <cstdint>
+#include <iostream>
+#include <string_view>
+#include <vector>
+
+/****************************************************************
+* Tracing
+*
+* Unlike StopWatch, which is meant for timing a few coarse events
+* by name, this is meant to be left in hot code, including inside
+* par::map/for_each workers. Recording an event does  not  allo-
+* cate, lock, or look anything up:
+*
+*   - Events are identified by the address of a  string  literal
+*     (the macros only accept literals), which is fixed at  link
+*     time, and which is only turned into a name on export.
+*   - Each thread writes to its own fixed-size ring buffer which
+*     is only shared with whoever drains it, so writing is a few
+*     plain stores followed by one release store.
+*   - Timestamps come from steady_clock (CLOCK_MONOTONIC on Lin-
+*     ux, read through the vDSO without a system call).
+*
+* If a ring fills up before being drained then new events on that
+* thread are dropped (and counted) rather than blocking. The ring
+* of a thread that has exited is freed once it has been drained.
+*
+* The  TRACE_*  macros  compile  to  nothing unless ENABLE_TRACING
+* is  defined,  so  they  can be left in the code. Example:
+*
+*   void f() {
+*       TRACE_SCOPE( "f" );
+*       ...
+*   }
+*   ...
+*   util::trace::write_chrome_json( "trace.json" );
+*
+* The  output  can be opened in chrome://tracing or Perfetto.
+****************************************************************/
+namespace util::trace {
+
+struct Event {
+    // The string literal given to the macro.
+    char const* name;
+    // Nanoseconds since an arbitrary (but fixed) point.
+    uint64_t    start_ns;
+    // Zero for instant events.
+    uint64_t    dur_ns;
+    // Small integer assigned to each thread that records events,
+    // in the order in which they first do so.
+    uint32_t    tid;
+    bool        instant;
+};
+
+// Current time, in the same units and epoch as Event::start_ns.
+uint64_t now_ns();
+
+// Records an event in the calling thread's ring. These are called
+// by the macros; name must outlive the trace (i.e., be a literal).
+void record( char const* name, uint64_t start_ns, uint64_t end_ns );
+void instant( char const* name );
+
+// Removes and returns all events from all threads that have been
+// recorded so far (including those of threads that have  since
+// exited), sorted by start time. May  be  called  while  other
+// threads are recording.
+std::vector<Event> drain();
+
+// Number of events dropped so far because a ring was full.
+uint64_t dropped();
+
+// Number of rings currently allocated: one per live thread  that
+// has recorded an event, plus one per exited thread whose events
+// have not been drained yet.
+size_t num_rings();
+
+// Writes the events in the Chrome trace-event JSON format.
+void write_chrome_json( std::ostream&             out,
+                        std::vector<Event> const& events );
+
+// Drains all events and writes them to the given file.
+void write_chrome_json( fs::path const& p );
+
+// Records the time between construction and destruction.
+class Scope {
+
+public:
+    explicit Scope( char const* name )
+        : m_name( name ), m_start( now_ns() ) {}
+    ~Scope() { record( m_name, m_start, now_ns() ); }
+
+    Scope( Scope const& )            = delete;
+    Scope& operator=( Scope const& ) = delete;
+
+private:
+    char const* m_name;
+    uint64_t    m_start;
+};
+
+} // namespace util::trace
+
+// The "" forces the argument to be a string literal.
+#ifdef ENABLE_TRACING
+#    define TRACE_SCOPE( name )                                \
+         ::util::trace::Scope                                  \
+             STRING_JOIN( trace_scope_, __LINE__ )( "" name )
+#    define TRACE_INSTANT( name )                              \
+         ::util::trace::instant( "" name )
+#else
+#    define TRACE_SCOPE( name )
+#    define TRACE_INSTANT( name )
+#endif
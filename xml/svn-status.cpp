@@ -40,19 +40,6 @@ namespace xpaths {
 
 } // anonymous namespace
 
-#define CHANGE( a ) { #a, Status::ChangeType::a }
-
-// Global map from  enum  to  corresponding string representation.
-CTMap g_change{
-
-    CHANGE( modified    ),
-    CHANGE( added       ),
-    CHANGE( deleted     ),
-    CHANGE( conflicted  ),
-    CHANGE( unversioned )
-
-};
-
 // Take a string holding  the  output  of  the `svn status --xml`
 // command and parse it,  then  extract  enough information to re-
 // turn a list Status descriptors. Throws  on  error  or  if  the
@@ -82,10 +69,11 @@ vector<Status> parse_status_xml( istream& in_xml ) {
 
         // If  it's  not  a key that we're concerned with then we
         // won't even include this item in the result.
-        if( !g_change.val_safe( *item ) )
+        auto change = g_change.val_safe( *item );
+        if( !change )
             continue;
 
-        s.change = g_change.val( *item );
+        s.change = *change;
 
         auto p = xml::attr( n, xpaths::path, {}, false );
         ASSERT( p, "failed to find precisely one non-empty "
@@ -157,7 +145,7 @@ string to_string( svn::Status const& s ) {
 
 template<>
 string to_string( svn::Status::ChangeType const& s ) {
-    return svn::g_change.key( s );
+    return string( svn::g_change.key( s ) );
 }
 
 } // namespace util
@@ -40,10 +40,23 @@ struct Status {
     bool         tree_conflict;
 };
 
-using CTMap = util::BiMapFixed<std::string,Status::ChangeType>;
-// Construct a global  map  to  change  between  enums  and their
-// string representations.
-extern CTMap g_change;
+using CTMap = util::StaticBiMap<Status::ChangeType, 5>;
+
+#define CHANGE( a ) { #a, Status::ChangeType::a }
+
+// Global  map  to  change  between  enums  and  their string repre-
+// sentations. This is built at compile time.
+inline constexpr CTMap g_change{ {
+
+    CHANGE( modified    ),
+    CHANGE( added       ),
+    CHANGE( deleted     ),
+    CHANGE( conflicted  ),
+    CHANGE( unversioned )
+
+} };
+
+#undef CHANGE
 
 // Take a string holding  the  output  of  the `svn status --xml`
 // command and parse it,  then  extract  enough information to re-
@@ -1,6 +1,7 @@
 /****************************************************************
 * Utility Functions for Use with PugiXml
 ****************************************************************/
+#include "latency.hpp"
 #include "macros.hpp"
 #include "string-util.hpp"
 #include "xml-util.hpp"
@@ -65,6 +66,9 @@ void parse( pugi::xml_document& doc,
             istream&            in,
             string const&       err_msg ) {
 
+    static auto& hist = util::latency_histogram( "xml::parse" );
+    TIMED_SCOPE( hist );
+
     pugi::xml_parse_result res = doc.load( in );
 
     if( res )
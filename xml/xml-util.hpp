@@ -5,6 +5,7 @@
 
 #include "macros.hpp"
 #include "pugixml.hpp"
+#include "string-util.hpp"
 #include "types.hpp"
 
 #include <string>
@@ -71,6 +72,10 @@ std::optional<T> attribute( pugi::xml_node const& node,
     if( auto attr = node.attribute( name ).as_string( NULL ); attr ) {
         if constexpr( std::is_convertible_v<decltype( attr ),T> )
             return T( attr );
+        else if constexpr( util::is_parsable_v<T> )
+            // Numbers are parsed directly from the attribute's
+            // characters without constructing a stream.
+            return util::parse<T>( attr );
         else {
             T res; std::istringstream ss( attr );
             // Ensure it parsed successfully  and  exhausted  the